@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <chrono>
 
 #include "AudioGraphics.hpp"
@@ -41,10 +42,8 @@ static float idleFrameSteps[FRAMESTEPCOUNT][2];
 static bool idleFrameStepsInitialized = false;
 
 AudioGraphicsBuilder::AudioGraphicsBuilder()
-    : m_readIdx(0)
-    , m_writeIdx(0)
+    : m_bufferSize(0)
     , m_bufferCount(0)
-    , m_bufferSize(0)
     , m_wfx{0}
 {
     m_frameEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
@@ -52,16 +51,198 @@ AudioGraphicsBuilder::AudioGraphicsBuilder()
         buildFrameSteps(idleFrameSteps, FRAMESTEPCOUNT);
         idleFrameStepsInitialized = true;
     }
+    m_jitReader = std::make_unique<DisplayList::Reader>(m_jitLists[m_jitFront]);
 }
 
 AudioGraphicsBuilder::~AudioGraphicsBuilder()
 {
+    setPipelined(false);
     if (m_frameEvent) CloseHandle(m_frameEvent);
 }
 
+void AudioGraphicsBuilder::setPipelined(bool pipelined)
+{
+    if (pipelined == m_pipelined) return;
+
+    if (pipelined) {
+        m_pipelined = true;
+        m_handoffGeneration = 0;
+        m_encoderThread = std::thread(&AudioGraphicsBuilder::EncoderThreadMain, this);
+    } else {
+        {
+            // encoder thread finishes the pending frame before exiting
+            std::lock_guard<std::mutex> lock(m_encoderMutex);
+            m_pipelined = false;
+        }
+        m_encoderCv.notify_all();
+        if (m_encoderThread.joinable()) m_encoderThread.join();
+    }
+}
+
+void AudioGraphicsBuilder::EncoderThreadMain()
+{
+    std::unique_lock<std::mutex> lock(m_encoderMutex);
+    for (;;) {
+        m_encoderCv.wait(lock, [this] { return m_framePending || !m_pipelined; });
+        if (!m_framePending) break;
+
+        if (m_pendingListNew) {
+            std::swap(m_pendingList, m_encodingList);
+            m_pendingListNew = false;
+        }
+        m_framePending = false;
+
+        // let the application submit next frame while this one is being encoded
+        lock.unlock();
+        m_encoderCv.notify_all();
+
+        EncodeFrame(m_encodingList);
+
+        lock.lock();
+    }
+}
+
+void AudioGraphicsBuilder::setJustInTime(bool justInTime)
+{
+    m_justInTime = justInTime;
+    m_jitGeneration = 0;
+}
+
+void AudioGraphicsBuilder::setMotionProfile(bool motionProfile)
+{
+    m_motionProfile = motionProfile;
+    // Encoded frames and instances are sampled by the previous mode
+    m_frameGeneration = 0;
+    m_jitGeneration = 0;
+    m_instanceBlocks.clear();
+}
+
+void AudioGraphicsBuilder::PublishFrame(DisplayList& frame)
+{
+    // Audio thread has the frame already if it has not changed
+    const uint64_t generation = frame.Seal();
+    if (generation == m_jitGeneration) return;
+    m_jitGeneration = generation;
+
+    size_t layerSamples[DisplayList::MaxLayers];
+    CountLayerSamples(frame, m_detail, layerSamples);
+    SetFrameSampleCount(layerSamples, float(m_wfx.nSamplesPerSec), m_detail);
+
+    m_jitLists[m_jitBack] = frame;
+    SlotBases(m_jitSlotBases[m_jitBack]);
+    // Audio thread continues the refresh from these without reading the frame up to its position
+    DisplayList::Reader::ReadPositions(m_jitLists[m_jitBack], m_jitPositions[m_jitBack], m_jitPrimitivePositions[m_jitBack], &m_frameArena);
+    m_jitBack = m_jitPublished.exchange(m_jitBack | NewFrameFlag, std::memory_order_acq_rel) & ~NewFrameFlag;
+}
+
+bool AudioGraphicsBuilder::TakePublishedFrame()
+{
+    if (!(m_jitPublished.load(std::memory_order_acquire) & NewFrameFlag)) return false;
+    m_jitFront = m_jitPublished.exchange(m_jitFront, std::memory_order_acq_rel) & ~NewFrameFlag;
+    SetEvent(m_frameEvent);
+
+    // New frame continues from the position reached in the previous one
+    const std::vector<size_t>& primitivePositions = m_jitPrimitivePositions[m_jitFront];
+    m_jitPosition = MIN(m_jitPosition, primitivePositions.size() - 1);
+    m_jitReader->Seek(m_jitPositions[m_jitFront], primitivePositions[m_jitPosition]);
+    m_jitCtx.syncPoint = true;
+    // Pending line of the previous frame ends at rest before the next primitive
+    m_jitLayer = -1;
+    return true;
+}
+
+bool AudioGraphicsBuilder::EncodeNextPrimitive()
+{
+    GraphicsPrimitive p;
+    for (;;) {
+        if (!m_jitReader->Next(p)) {
+            // Last line of the refresh ends at rest
+            const int finished = FinishMotionLine(m_jitCtx);
+            const bool drawn = m_jitDrawn;
+            m_jitReader->Restart(m_jitLists[m_jitFront]);
+            m_jitPosition = 0;
+            m_jitDrawn = false;
+            m_jitCtx = {false, nullptr, -1};
+            m_jitLayer = -1;
+            m_refreshCount++;
+            if (finished) return true;
+            if (!drawn) return false;
+            continue;
+        }
+        m_jitPosition++;
+
+        // Pending line ends at rest when a primitive of another layer comes between, like when layers are encoded
+        // one after another
+        const int layer = m_jitReader->Layer();
+        const int finished = layer != m_jitLayer ? FinishMotionLine(m_jitCtx) : 0;
+        m_jitLayer = layer;
+        if (!LayerDue(layer, m_refreshCount)) {
+            if (finished) return true;
+            continue;
+        }
+
+        m_jitCtx.slot = m_jitReader->Slot();
+        EncodePrimitive(p, m_jitCtx);
+        m_jitDrawn = true;
+        return true;
+    }
+}
+
+void AudioGraphicsBuilder::FillJustInTime(uint8_t* data, size_t size)
+{
+    TakePublishedFrame();
+    m_slotBases = m_jitSlotBases[m_jitFront];
+    if (m_jitLists[m_jitFront].Slots()) ReadLatchTransforms(m_jitSlots);
+
+    // Samples of a primitive that did not fit the previous buffer are output first
+    size_t written = MIN(size, m_frameSamples.size() - m_jitOffset);
+    if (written) memcpy(data, m_frameSamples.data() + m_jitOffset, written);
+    m_jitOffset += written;
+
+    // Primitives are encoded straight to the buffer, samples past its end are kept for the next one
+    while (written < size) {
+        m_frameSamples.clear();
+        m_frameLatched.clear();
+        m_jitOffset = 0;
+        m_direct = data + written;
+        m_directSize = size - written;
+        m_directUsed = 0;
+        const bool encoded = EncodeNextPrimitive();
+        FlushRun();
+        if (!m_frameLatched.empty()) {
+            LatchSamples(m_frameLatched, 0, m_directUsed, m_direct, m_jitSlots);
+            LatchSamples(m_frameLatched, m_directUsed, m_directUsed + m_frameSamples.size(), m_frameSamples.data(), m_jitSlots);
+        }
+        written += m_directUsed;
+        if (!encoded) break;
+    }
+    m_direct = nullptr;
+    m_directUsed = 0;
+    if (written < size) memset(data + written, 0, size - written);
+}
+
 bool AudioGraphicsBuilder::WaitSync(int timeout)
 {
-    if (m_writeIdx - m_readIdx > QUEUE_WATERMARK) {
+    if (m_justInTime) {
+        // Audio thread must have taken the last published frame
+        while (m_jitPublished.load(std::memory_order_acquire) & NewFrameFlag) {
+            if (WaitForSingleObject(m_frameEvent, timeout ? timeout : INFINITE) != WAIT_OBJECT_0) return false;
+        }
+        return true;
+    }
+
+    if (m_pipelined) {
+        // Encoder must have picked up the previous frame so that Submit does not block
+        std::unique_lock<std::mutex> lock(m_encoderMutex);
+        auto pickedUp = [this] { return !m_framePending; };
+        if (timeout) {
+            if (!m_encoderCv.wait_for(lock, std::chrono::milliseconds(timeout), pickedUp)) return false;
+        } else {
+            m_encoderCv.wait(lock, pickedUp);
+        }
+    }
+
+    if (m_renderRing.Size() > QUEUE_WATERMARK) {
         DWORD res = WaitForSingleObject(m_frameEvent, timeout ? timeout : INFINITE);
 
         if (res != WAIT_OBJECT_0) return false;
@@ -69,104 +250,286 @@ bool AudioGraphicsBuilder::WaitSync(int timeout)
     return true;
 }
 
-void AudioGraphicsBuilder::Submit() { EncodeAudio(m_operations); }
+void AudioGraphicsBuilder::Submit()
+{
+    if (m_justInTime) {
+        ResetFrameArena();
+        PublishFrame(PrepareFrame(m_recorder.List()));
+        return;
+    }
+
+    if (!m_pipelined) {
+        EncodeFrame(m_recorder.List());
+        return;
+    }
 
-template <typename T>
-inline T Convert(float Value);
+    std::unique_lock<std::mutex> lock(m_encoderMutex);
+    m_encoderCv.wait(lock, [this] { return !m_framePending; });
 
-template <>
-inline float Convert<float>(float Value)
-{
-    return (Value);
-};
+    // Copy only changed lists, encoder still holds the last one handed over
+    DisplayList& list = m_recorder.List();
+    const uint64_t generation = list.Seal();
+    if (generation != m_handoffGeneration) {
+        m_pendingList = list;
+        m_pendingListNew = true;
+        m_handoffGeneration = generation;
+    }
+    m_framePending = true;
+    lock.unlock();
+    m_encoderCv.notify_all();
+}
 
-template <>
-inline short Convert<short>(float Value)
+void AudioGraphicsBuilder::EncodeFrame(DisplayList& list)
 {
-    return (short)CLAMP(roundf(Value * _I16_MAX), _I16_MIN, _I16_MAX);    
-};
+    ResetFrameArena();
+    DisplayList& frame = PrepareFrame(list);
+    SlotBases(m_frameSlotBases);
+    m_slotBases = m_frameSlotBases;
+
+    // Unchanged display list is played again from the samples encoded on a previous submit
+    const uint64_t generation = frame.Seal();
+    if (generation != m_frameGeneration) {
+        if (m_targetRefreshRate > 0) FitDetail(frame);
+        EncodeAudio(frame);
+        m_frameGeneration = generation;
+
+        size_t layerSamples[DisplayList::MaxLayers];
+        for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+            layerSamples[layer] = (m_layerOffsets[layer + 1] - m_layerOffsets[layer]) / m_wfx.nBlockAlign;
+        }
+        SetFrameSampleCount(layerSamples, float(m_wfx.nSamplesPerSec), m_detail);
+
+        if (m_progressive) {
+            // samples were queued while encoding
+            m_refreshCount++;
+            EndRefresh();
+            return;
+        }
+    }
+    QueueFrame();
+}
 
-template <>
-inline int32_t Convert<int32_t>(float Value)
+void AudioGraphicsBuilder::setTargetRefreshRate(float hz)
 {
-    return (int32_t)roundf(Value * _I32_MAX);
-};
+    m_targetRefreshRate = hz;
+    m_detail = 1.0f;
+    m_frameGeneration = 0;
+}
 
-bool AudioGraphicsBuilder::AddToBuffer(float x, float y, EncodeCtx& ctx)
+// Scales segment density so that the frame fits the sample budget of the target refresh rate.
+// Every primitive takes at least one sample, only the samples above that scale with the density.
+// Layers with a refresh divisor count only the part of their samples they add to an average refresh.
+// The factor is refined in a few passes starting from the factor of the previous frame.
+void AudioGraphicsBuilder::FitDetail(const DisplayList& list)
 {
-    void* buffer = m_audioBuffer.data() + m_bufferIdx;
-    if (m_sampleType == RenderSampleType::SampleType16BitPCM) {
-        short* pcmbuffer = static_cast<short*>(buffer);
-        pcmbuffer[0] = Convert<short>(x);  // left channel
-        pcmbuffer[1] = Convert<short>(y);  // right channel
-    } else if (m_sampleType == RenderSampleType::SampleType24BitPCM) {
-        uint8_t* pcmbuffer = static_cast<uint8_t*>(buffer);
-        int32_t v;
+    const float MinDetail = 1.0f / 16;
+    const float MaxDetail = 64.0f;
+    const float budget = m_wfx.nSamplesPerSec / m_targetRefreshRate;
+
+    const float fixed = RefreshSamples(list, 0);
+    if (fixed >= budget) {
+        // does not fit even without detail
+        m_detail = MinDetail;
+        return;
+    }
+
+    float detail = m_detail;
+    for (int pass = 0; pass < 4; pass++) {
+        const float samples = RefreshSamples(list, detail);
+        if (samples <= fixed) break;
+        // accept frames that are a little short of the budget
+        if (samples <= budget && samples > budget * 0.95f) break;
+
+        const float next = CLAMP(detail * (budget - fixed) / (samples - fixed), MinDetail, MaxDetail);
+        if (next == detail) break;
+        detail = next;
+    }
+    m_detail = detail;
+}
 
-        v = Convert<int32_t>(x) >> 8;
-        pcmbuffer[0] = v & 0xFF;
-        pcmbuffer[1] = (v >> 8) & 0xFF;
-        pcmbuffer[2] = (v >> 16) & 0xFF;
+void AudioGraphicsBuilder::WriteSample(uint8_t* buffer, float x, float y)
+{
+    m_convert(&x, &y, 1, buffer);
+}
 
-        v = Convert<int32_t>(y) >> 8;
-        pcmbuffer[3] = v & 0xFF;
-        pcmbuffer[4] = (v >> 8) & 0xFF;
-        pcmbuffer[5] = (v >> 16) & 0xFF;
-    } else if (m_sampleType == RenderSampleType::SampleTypeFloat) {
-        float* fltbuffer = static_cast<float*>(buffer);
-        fltbuffer[0] = Convert<float>(x);  // left channel
-        fltbuffer[1] = Convert<float>(y);  // right channel
+void AudioGraphicsBuilder::FlushRun()
+{
+    if (m_runCount == 0) return;
+    size_t direct = 0;
+    if (m_direct && m_frameSamples.empty()) {
+        direct = MIN(m_runCount, (m_directSize - m_directUsed) / m_wfx.nBlockAlign);
+        m_convert(m_runX, m_runY, direct, m_direct + m_directUsed);
+        m_directUsed += direct * m_wfx.nBlockAlign;
     }
-    m_bufferIdx += m_wfx.nBlockAlign;
-    assert(m_bufferIdx <= m_bufferSize);
+    if (direct < m_runCount) {
+        const size_t idx = m_frameSamples.size();
+        m_frameSamples.resize(idx + (m_runCount - direct) * m_wfx.nBlockAlign);
+        m_convert(m_runX + direct, m_runY + direct, m_runCount - direct, m_frameSamples.data() + idx);
+    }
+    m_runCount = 0;
+}
 
-    if (m_bufferIdx >= m_bufferSize) {
-        // audiorender buffer is full, submit it for rendering
-        QueueBuffer();
+bool AudioGraphicsBuilder::AddToBuffer(float x, float y, EncodeCtx& ctx, bool fixed)
+{
+    if (ctx.capture) {
+        ctx.capture->push_back({{x, y}, fixed});
+        return true;
     }
+    if (ctx.slot >= 0 && !fixed) m_frameLatched.push_back({FrameBytes(), ctx.slot, m_slotBases[ctx.slot].Apply({x, y})});
+    m_runX[m_runCount] = x;
+    m_runY[m_runCount] = y;
+    if (++m_runCount == RunLength) FlushRun();
     return true;
 }
 
+void AudioGraphicsBuilder::QueueSamples(size_t offset, size_t size)
+{
+    // Latched samples follow their bytes to the buffers
+    auto latched = std::lower_bound(m_frameLatched.begin(), m_frameLatched.end(), offset,
+        [](const LatchedSample& s, size_t offset) { return s.offset < offset; });
+
+    while (size > 0) {
+        const size_t count = MIN(size, size_t(m_bufferSize - m_bufferIdx));
+        memcpy(WriteBuffer() + m_bufferIdx, m_frameSamples.data() + offset, count);
+        for (; latched != m_frameLatched.end() && latched->offset < offset + count; ++latched) {
+            m_audioLatched.push_back({latched->offset - offset + m_bufferIdx, latched->slot, latched->p});
+        }
+        m_bufferIdx += int(count);
+        offset += count;
+        size -= count;
+
+        if (m_bufferIdx >= m_bufferSize) {
+            // audiorender buffer is full, submit it for rendering
+            QueueBuffer();
+        }
+    }
+}
+
+void AudioGraphicsBuilder::QueueFrame()
+{
+    // Layers that are not due on this refresh are skipped
+    const uint32_t refresh = m_refreshCount++;
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+        if (!LayerDue(layer, refresh)) continue;
+        QueueSamples(m_layerOffsets[layer], m_layerOffsets[layer + 1] - m_layerOffsets[layer]);
+    }
+    EndRefresh();
+}
+
+void AudioGraphicsBuilder::EndRefresh()
+{
+    if (m_fixedRate) {
+        // This mode submits always buffers for rendering, even when there is
+        // not enough data in the buffer. This limits rendering speed.
+        if (m_bufferIdx > 0) {
+            if (m_idleBox) {
+                FillIdle();
+            } else {
+                // send partially completed buffer
+                QueueBuffer();
+            }
+        }
+    }
+}
+
+uint8_t* AudioGraphicsBuilder::WriteBuffer()
+{
+    if (!m_writeBuffer) {
+        m_writeBuffer = m_renderRing.Back();
+        if (!m_writeBuffer) m_writeBuffer = m_overflowBuffer.data();
+    }
+    return m_writeBuffer;
+}
+
 void AudioGraphicsBuilder::QueueBuffer()
 {
     m_bufferCount++;
 
+    uint8_t* buffer = WriteBuffer();
     if (m_bufferIdx < m_bufferSize) {
         // zero out remaining bytes
-        memset(m_audioBuffer.data() + m_bufferIdx, 0, m_bufferSize - m_bufferIdx);
+        memset(buffer + m_bufferIdx, 0, m_bufferSize - m_bufferIdx);
     }
 
-    // audiorender buffer is full, submit it for rendering
-    m_renderBuffer[m_writeIdx % m_renderBuffer.size()] = m_audioBuffer;
-    m_writeIdx++;
+    // audiorender buffer is full, submit it for rendering. Buffer in the overflow storage is dropped.
+    if (buffer != m_overflowBuffer.data()) {
+        // storage of the latched samples circulates between the buffers
+        std::swap(m_renderLatched[m_renderRing.BackIndex()], m_audioLatched);
+        m_renderRing.Push();
+    }
+    m_audioLatched.clear();
+    m_writeBuffer = nullptr;
     m_bufferIdx = 0;
 }
 
 const float SpeedMultiplier = 1.5f;
 
-int AudioGraphicsBuilder::EncodeCircle(const GraphicsPrimitive& p, EncodeCtx& ctx)
+// Detail scales the segment density, 1 is the default density
+static int circleStepCount(const DisplayList::Primitive& p, float detail)
 {
     const float CircleSegmentMultiplier = 50.0f;  // how many segments in unit circle
-    const float Pi = 3.14159f;
-    const int stepCount = lround(CircleSegmentMultiplier * p.r * p.intensity * SpeedMultiplier);
-    const float angleStep = Pi * 2 / stepCount;
+    const float arc = (p.arcEnd - p.arcStart) / DisplayList::FullCircle;
+    return MAX(1, lround(CircleSegmentMultiplier * p.r * p.intensity * SpeedMultiplier * arc * detail));
+}
+
+// Vertices have the device scale applied, it is removed so that the scale does not change the beam speed
+static inline float unscaledLength(Point p0, Point p1, float xscale, float yscale)
+{
+    const float vx = (p1.x - p0.x) / xscale;
+    const float vy = (p1.y - p0.y) / yscale;
+    return sqrtf(vx * vx + vy * vy);
+}
+
+const float LineSegmentMultiplier = 12.0f;  // how many segments in a unit line
+
+static int pathStepCount(float length, float intensity, float detail)
+{
+    return lround(LineSegmentMultiplier * length * intensity * SpeedMultiplier * detail + 0.5f);
+}
+
+// Parametric curves are sampled at the step length of lines. Where the curve turns tighter than a step, steps are
+// shortened so that the beam path cuts at most this part of a step off the curve.
+const float ParametricTolerance = 0.125f;
+
+static float pathStepLength(float intensity, float detail)
+{
+    return 1.0f / (LineSegmentMultiplier * MAX(intensity, 0.01f) * SpeedMultiplier * detail);
+}
+
+static int lineStepCount(const DisplayList::Primitive& p, float xscale, float yscale, float detail)
+{
+    return pathStepCount(unscaledLength(p.p, p.toPoint, xscale, yscale), p.intensity, detail);
+}
+
+// Curve length is estimated as the average of the chord and the control polygon lengths
+static int curveStepCount(const DisplayList::Primitive& p, float xscale, float yscale, float detail)
+{
+    const float chord = unscaledLength(p.p, p.toPoint, xscale, yscale);
+    const float polygon = unscaledLength(p.p, p.control1, xscale, yscale) + unscaledLength(p.control1, p.control2, xscale, yscale) +
+                          unscaledLength(p.control2, p.toPoint, xscale, yscale);
+    return pathStepCount((chord + polygon) / 2, p.intensity, detail);
+}
+
+int AudioGraphicsBuilder::EncodeCircle(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    const int stepCount = circleStepCount(p, m_detail);
+    const float angleStep = (p.arcEnd - p.arcStart) / stepCount;
 
     for (int i = 0; i < stepCount + 1; i++) {
-        float x = p.r * sinf(i * angleStep) + p.p.x;
-        float y = p.r * cosf(i * angleStep) + p.p.y;
-        AddToBuffer(x * m_xScale, y * m_yScale, ctx);
+        const float s = sinf(p.arcStart + i * angleStep);
+        const float c = cosf(p.arcStart + i * angleStep);
+        float x = p.p.x + s * p.axisX.x + c * p.axisY.x;
+        float y = p.p.y + s * p.axisX.y + c * p.axisY.y;
+        AddToBuffer(x, y, ctx);
     }
     return stepCount;
 }
 
 int AudioGraphicsBuilder::EncodeLine(const GraphicsPrimitive& p, EncodeCtx& ctx)
 {
-    const float LineSegmentMultiplier = 12.0f;  // how many segments in a unit line
-    // get line length
     const float vx = p.toPoint.x - p.p.x;
     const float vy = p.toPoint.y - p.p.y;
-    const float l = sqrtf(vx * vx + vy * vy);
-    int stepCount = lround(LineSegmentMultiplier * l * p.intensity * SpeedMultiplier + 0.5f);
+    int stepCount = lineStepCount(p, m_xScale, m_yScale, m_detail);
 
     // If syncpoint has not been set don't draw the first dot as it was drawn already on previous
     // encode call.
@@ -175,34 +538,188 @@ int AudioGraphicsBuilder::EncodeLine(const GraphicsPrimitive& p, EncodeCtx& ctx)
     for (int i = startPoint; i <= stepCount; i++) {
         float x = p.p.x + i * vx / stepCount;
         float y = p.p.y + i * vy / stepCount;
-        AddToBuffer(x * m_xScale, y * m_yScale, ctx);
+        AddToBuffer(x, y, ctx);
+    }
+    ctx.syncPoint = false;
+    return stepCount - startPoint;
+}
+
+int AudioGraphicsBuilder::EncodeCurve(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    const int stepCount = curveStepCount(p, m_xScale, m_yScale, m_detail);
+
+    // Curve is flattened straight to samples, first dot is skipped like on lines
+    int startPoint = ctx.syncPoint ? 0 : 1;
+
+    for (int i = startPoint; i <= stepCount; i++) {
+        const Point c = p.CurvePoint(float(i) / stepCount);
+        AddToBuffer(c.x, c.y, ctx);
     }
     ctx.syncPoint = false;
     return stepCount - startPoint;
 }
 
+int AudioGraphicsBuilder::EncodeParametric(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    const float step = pathStepLength(p.intensity, m_detail);
+    const size_t count = m_parametricSampler.Sample(p, step, step * ParametricTolerance, {m_xScale, m_yScale});
+    const Point* points = m_parametricSampler.Points();
+
+    // Curve starts from its own point like an arc
+    for (size_t i = 0; i < count; i++) AddToBuffer(points[i].x, points[i].y, ctx);
+    return int(count) - 1;
+}
+
 int AudioGraphicsBuilder::EncodeSync(const GraphicsPrimitive& p, EncodeCtx& ctx)
 {
-    AddToBuffer(0, 0, ctx);
+    AddToBuffer(0, 0, ctx, true);
     ctx.syncPoint = true;
     return 1;
 }
 
+// Line speeds are the step lengths of the intensities at the ends
+MotionProfile::Line AudioGraphicsBuilder::MotionLine(const GraphicsPrimitive& p, float detail) const
+{
+    return {p.p, p.toPoint, pathStepLength(p.intensity, detail), pathStepLength(p.toIntensity, detail)};
+}
+
+void AudioGraphicsBuilder::AddMotionPoints(size_t count, int slot, EncodeCtx& ctx)
+{
+    // Samples are on the slot of the line they belong to
+    const int current = ctx.slot;
+    ctx.slot = slot;
+    const Point* points = m_motion.Points();
+    for (size_t i = 0; i < count; i++) AddToBuffer(points[i].x, points[i].y, ctx);
+    ctx.slot = current;
+}
+
+int AudioGraphicsBuilder::EncodeMotionLine(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    const int slot = ctx.motion.slot;
+    const size_t count = m_motion.Add(ctx.motion, MotionLine(p, m_detail), ctx.slot, {m_xScale, m_yScale});
+    AddMotionPoints(count, slot, ctx);
+
+    // First dot is drawn only after a sync point like on uniform lines
+    const int startPoint = ctx.syncPoint ? 1 : 0;
+    if (ctx.syncPoint) AddToBuffer(p.p.x, p.p.y, ctx);
+    ctx.syncPoint = false;
+    return int(count) + startPoint;
+}
+
+int AudioGraphicsBuilder::FinishMotionLine(EncodeCtx& ctx)
+{
+    const int slot = ctx.motion.slot;
+    const size_t count = m_motion.Finish(ctx.motion, {m_xScale, m_yScale});
+    AddMotionPoints(count, slot, ctx);
+    return int(count);
+}
+
+int AudioGraphicsBuilder::EncodePrimitive(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    // Pending line ends at rest before anything else than a line
+    int finished = 0;
+    if (m_motionProfile) {
+        if (p.type == GraphicsPrimitive::Type::DRAW_LINE) return EncodeMotionLine(p, ctx);
+        finished = FinishMotionLine(ctx);
+    }
+
+    switch (p.type) {
+        case GraphicsPrimitive::Type::DRAW_CIRCLE: return finished + EncodeCircle(p, ctx);
+        case GraphicsPrimitive::Type::DRAW_LINE: return finished + EncodeLine(p, ctx);
+        case GraphicsPrimitive::Type::DRAW_CURVE: return finished + EncodeCurve(p, ctx);
+        case GraphicsPrimitive::Type::DRAW_PARAMETRIC: return finished + EncodeParametric(p, ctx);
+        case GraphicsPrimitive::Type::DRAW_SYNC: return finished + EncodeSync(p, ctx);
+        default:
+            // Unknown
+            return finished;
+    }
+}
+
+int AudioGraphicsBuilder::EncodeInstance(const DisplayList::Reader::Instance& instance, EncodeCtx& ctx)
+{
+    const int finished = FinishMotionLine(ctx);
+    const Transform& t = instance.transform;
+    auto matches = [&](const InstanceBlock& b) {
+        return b.shape == instance.shape.get() && !b.shapeRef.expired() && b.a == t.a && b.b == t.b && b.c == t.c && b.d == t.d && b.radiusScale == instance.radiusScale &&
+               b.intensity == instance.intensity && b.detail == m_detail && b.syncPointBefore == ctx.syncPoint;
+    };
+    InstanceBlock* block = nullptr;
+    for (auto& b : m_instanceBlocks) {
+        if (matches(b)) {
+            block = &b;
+            break;
+        }
+    }
+
+    if (!block) {
+        // Shape is encoded without translation, which is added when the samples are written
+        const size_t MaxInstanceBlocks = 256;
+        if (m_instanceBlocks.size() >= MaxInstanceBlocks) m_instanceBlocks.clear();
+        m_instanceBlocks.push_back({instance.shape.get(), instance.shape, t.a, t.b, t.c, t.d, instance.radiusScale, instance.intensity, m_detail, ctx.syncPoint});
+        block = &m_instanceBlocks.back();
+
+        DisplayList::Reader::Instance origin = instance;
+        origin.transform.tx = 0;
+        origin.transform.ty = 0;
+        EncodeCtx captureCtx{ctx.syncPoint, &block->samples, -1};
+        DisplayList::Reader reader(origin, &m_frameArena);
+        GraphicsPrimitive p;
+        block->points = 0;
+        while (reader.Next(p)) block->points += EncodePrimitive(p, captureCtx);
+        block->points += FinishMotionLine(captureCtx);
+        block->syncPointAfter = captureCtx.syncPoint;
+    }
+
+    // Samples on a slot are added one by one so that they are latched
+    if (!ctx.capture && ctx.slot < 0 && !block->placed.empty() && block->tx == t.tx && block->ty == t.ty) {
+        FlushRun();
+        m_frameSamples.insert(m_frameSamples.end(), block->placed.begin(), block->placed.end());
+        ctx.syncPoint = block->syncPointAfter;
+        return finished + block->points;
+    }
+
+    FlushRun();
+    const size_t start = m_frameSamples.size();
+    for (const auto& s : block->samples) {
+        if (s.fixed) {
+            AddToBuffer(s.p.x, s.p.y, ctx, true);
+        } else {
+            AddToBuffer(s.p.x + t.tx, s.p.y + t.ty, ctx);
+        }
+    }
+    if (!ctx.capture) {
+        FlushRun();
+        block->tx = t.tx;
+        block->ty = t.ty;
+        block->placed.assign(m_frameSamples.begin() + start, m_frameSamples.end());
+    }
+    ctx.syncPoint = block->syncPointAfter;
+    return finished + block->points;
+}
+
 // Keep beam out from center by drawing a box around screen
-void AudioGraphicsBuilder::FillIdle(EncodeCtx& ctx)
+void AudioGraphicsBuilder::FillIdle()
 {
     static unsigned int step = 0;
 
+    // Box is converted a run at a time, the run is empty between frames
     while (m_bufferIdx < m_bufferSize && m_bufferIdx != 0) {
-        float x = idleFrameSteps[step % FRAMESTEPCOUNT][0];
-        float y = idleFrameSteps[step % FRAMESTEPCOUNT][1];
-        step++;
-        AddToBuffer(x, y, ctx);
+        const size_t count = MIN(size_t(m_bufferSize - m_bufferIdx) / m_wfx.nBlockAlign, RunLength);
+        for (size_t i = 0; i < count; i++, step++) {
+            m_runX[i] = idleFrameSteps[step % FRAMESTEPCOUNT][0];
+            m_runY[i] = idleFrameSteps[step % FRAMESTEPCOUNT][1];
+        }
+        m_convert(m_runX, m_runY, count, WriteBuffer() + m_bufferIdx);
+        m_bufferIdx += int(count * m_wfx.nBlockAlign);
     }
+    if (m_bufferIdx >= m_bufferSize) QueueBuffer();
 }
 
-void AudioGraphicsBuilder::EncodeAudio(const std::vector<GraphicsPrimitive>& ops)
+void AudioGraphicsBuilder::EncodeAudio(const DisplayList& list)
 {
+    m_frameSamples.clear();
+    m_frameLatched.clear();
+
 #if 0
     // Sawtooth debug signal
     EncodeCtx ctx{0};    
@@ -219,34 +736,116 @@ void AudioGraphicsBuilder::EncodeAudio(const std::vector<GraphicsPrimitive>& ops
         AddToBuffer(0.8f * i / float(steps), 0.8f * i / float(steps), ctx);
     }
 #else
+    // In progressive mode encoded samples of the layers due on this refresh are queued whenever they fill
+    // the current buffer. Layers are queued in the same order as in QueueFrame.
+    size_t queued = 0;
+    bool due = false;
+    auto queueEncoded = [&](bool all) {
+        const size_t pending = FrameBytes() - queued;
+        if (!due || pending == 0 || (!all && pending < size_t(m_bufferSize - m_bufferIdx))) return;
+        FlushRun();
+        QueueSamples(queued, pending);
+        queued += pending;
+    };
+
+    // Layers are encoded one after another, so that each can be queued on its own
     int points = 0;
-    EncodeCtx ctx{0};
-
-    for (size_t i = 0; i < ops.size(); i++) {
-        const GraphicsPrimitive& p = ops[i];
-        switch (p.type) {
-            case GraphicsPrimitive::Type::DRAW_CIRCLE: points += EncodeCircle(p, ctx); break;
-            case GraphicsPrimitive::Type::DRAW_LINE: points += EncodeLine(p, ctx); break;
-            case GraphicsPrimitive::Type::DRAW_SYNC: points += EncodeSync(p, ctx); break;
-            default:
-                // Unknown
-                break;
+    const uint32_t layers = list.Layers();
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+        m_layerOffsets[layer] = FrameBytes();
+        if (!(layers & (1u << layer))) continue;
+
+        queued = FrameBytes();
+        due = m_progressive && LayerDue(layer, m_refreshCount);
+
+        EncodeCtx ctx{false, nullptr, -1};
+        DisplayList::Reader reader(list, &m_frameArena);
+        DisplayList::Reader::Instance instance;
+        GraphicsPrimitive p;
+        for (;;) {
+            if (reader.NextInstance(instance)) {
+                if (reader.Layer() == layer) {
+                    ctx.slot = reader.Slot();
+                    points += EncodeInstance(instance, ctx);
+                } else {
+                    points += FinishMotionLine(ctx);
+                }
+                queueEncoded(false);
+                continue;
+            }
+            if (!reader.Next(p)) break;
+            if (reader.Layer() == layer) {
+                ctx.slot = reader.Slot();
+                points += EncodePrimitive(p, ctx);
+            } else {
+                // Line before a primitive of another layer ends at rest, the same as in just-in-time mode
+                points += FinishMotionLine(ctx);
+            }
+            queueEncoded(false);
         }
+        points += FinishMotionLine(ctx);
+        queueEncoded(true);
     }
+#endif
+    FlushRun();
+    m_layerOffsets[DisplayList::MaxLayers] = m_frameSamples.size();
+}
 
-    if (m_fixedRate) {
-        // This mode submits always buffers for rendering, even when there is
-        // not enough data in the buffer. This limits rendering speed.
-        if (m_bufferIdx > 0) {
-            if (m_idleBox) {
-                FillIdle(ctx);
-            } else {
-                // send partially completed buffer
-                QueueBuffer();
+float AudioGraphicsBuilder::RefreshSamples(const DisplayList& list, float detail)
+{
+    size_t layerSamples[DisplayList::MaxLayers];
+    CountLayerSamples(list, detail, layerSamples);
+
+    float samples = 0;
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) samples += float(layerSamples[layer]) / LayerRefreshDivisor(layer);
+    return samples;
+}
+
+void AudioGraphicsBuilder::CountLayerSamples(const DisplayList& list, float detail, size_t* samples)
+{
+    // Mirrors the sample output of the Encode functions, layers are encoded separately
+    bool syncPoint[DisplayList::MaxLayers] = {};
+    // Pending line ends at rest on a primitive of another layer, so there is at most one
+    MotionProfile::State motion;
+    int motionLayer = 0;
+    const Point scale{m_xScale, m_yScale};
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) samples[layer] = 0;
+
+    DisplayList::Reader reader(list, &m_frameArena);
+    GraphicsPrimitive p;
+    while (reader.Next(p)) {
+        const int layer = reader.Layer();
+        if (m_motionProfile) {
+            if (layer != motionLayer) samples[motionLayer] += m_countMotion.Finish(motion, scale);
+            motionLayer = layer;
+            if (p.type == GraphicsPrimitive::Type::DRAW_LINE) {
+                samples[layer] += m_countMotion.Add(motion, MotionLine(p, detail), -1, scale) + (syncPoint[layer] ? 1 : 0);
+                syncPoint[layer] = false;
+                continue;
             }
+            samples[layer] += m_countMotion.Finish(motion, scale);
+        }
+        switch (p.type) {
+            case GraphicsPrimitive::Type::DRAW_CIRCLE: samples[layer] += circleStepCount(p, detail) + 1; break;
+            case GraphicsPrimitive::Type::DRAW_LINE:
+                samples[layer] += lineStepCount(p, m_xScale, m_yScale, detail) + (syncPoint[layer] ? 1 : 0);
+                syncPoint[layer] = false;
+                break;
+            case GraphicsPrimitive::Type::DRAW_CURVE:
+                samples[layer] += curveStepCount(p, m_xScale, m_yScale, detail) + (syncPoint[layer] ? 1 : 0);
+                syncPoint[layer] = false;
+                break;
+            case GraphicsPrimitive::Type::DRAW_PARAMETRIC: {
+                const float step = pathStepLength(p.intensity, detail);
+                samples[layer] += m_countSampler.Sample(p, step, step * ParametricTolerance, {m_xScale, m_yScale});
+            } break;
+            case GraphicsPrimitive::Type::DRAW_SYNC:
+                samples[layer]++;
+                syncPoint[layer] = true;
+                break;
         }
     }
-#endif
+    samples[motionLayer] += m_countMotion.Finish(motion, scale);
 }
 
 //  Determine IEEE Float or PCM samples based on media type
@@ -256,12 +855,15 @@ void AudioGraphicsBuilder::ResolveMixFormatType(WAVEFORMATEX* wfx)
         ((wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE) && (reinterpret_cast<WAVEFORMATEXTENSIBLE*>(wfx)->SubFormat == KSDATAFORMAT_SUBTYPE_PCM))) {
         if (wfx->wBitsPerSample == 16) {
             m_sampleType = SampleType16BitPCM;
+            m_convert = SampleConversion::ToPCM16;
         } else if (wfx->wBitsPerSample == 24) {
             m_sampleType = SampleType24BitPCM;
+            m_convert = SampleConversion::ToPCM24;
         }
     } else if ((wfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT) ||
                ((wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE) && (reinterpret_cast<WAVEFORMATEXTENSIBLE*>(wfx)->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT))) {
         m_sampleType = RenderSampleType::SampleTypeFloat;
+        m_convert = SampleConversion::ToFloat;
     } else {
         m_sampleType = RenderSampleType::SampleTypeUnknown;
     }
@@ -272,6 +874,9 @@ HRESULT AudioGraphicsBuilder::Initialize(UINT32 FramesPerPeriod, WAVEFORMATEX* w
     HRESULT hr = S_OK;
 
     m_wfx = *wfx;
+    m_frameGeneration = 0;
+    // placed instance samples are in the old format
+    m_instanceBlocks.clear();
 
     if (m_wfx.nChannels != 2) {
         // must be stereo to encode X and Y
@@ -279,7 +884,12 @@ HRESULT AudioGraphicsBuilder::Initialize(UINT32 FramesPerPeriod, WAVEFORMATEX* w
     }
     int renderBufferSize = FramesPerPeriod * m_wfx.nBlockAlign;
     m_bufferSize = renderBufferSize;
-    m_audioBuffer.resize(m_bufferSize);
+    m_overflowBuffer.resize(m_bufferSize);
+    m_renderRing.Allocate(m_bufferSize, RenderBufferCount);
+    m_frontOffset = 0;
+    m_writeBuffer = nullptr;
+    m_bufferIdx = 0;
+    m_audioLatched.clear();
 
     ResolveMixFormatType(wfx);
     if (m_sampleType == RenderSampleType::SampleTypeUnknown) {
@@ -291,32 +901,95 @@ HRESULT AudioGraphicsBuilder::Initialize(UINT32 FramesPerPeriod, WAVEFORMATEX* w
 
 HRESULT AudioGraphicsBuilder::FillSampleBuffer(UINT32 BytesToRead, BYTE* Data)
 {
-    if (nullptr == Data) {
+    UINT32 written;
+    return ProduceSamples(BytesToRead, Data, &written);
+}
+
+HRESULT AudioGraphicsBuilder::ProduceSamples(UINT32 BytesAvailable, BYTE* Data, UINT32* BytesWritten)
+{
+    if (nullptr == Data || nullptr == BytesWritten) {
         return E_POINTER;
     }
+    const size_t size = BytesAvailable - BytesAvailable % m_wfx.nBlockAlign;
+    *BytesWritten = UINT32(size);
 
-    if (m_writeIdx - m_readIdx > 0) {
-        const std::vector<uint8_t>& buffer = m_renderBuffer[m_readIdx++ % m_renderBuffer.size()];
-        if (BytesToRead > buffer.size()) {
-            return E_INVALIDARG;
-        }
-        assert(BytesToRead == m_bufferSize);
-        memcpy(Data, buffer.data(), BytesToRead);
+    if (m_justInTime) {
+        FillJustInTime(Data, size);
+        return S_OK;
+    }
 
-    } else {
-        memset(Data, 0, BytesToRead);
+    size_t written = 0;
+    Transform slots[DisplayList::MaxTransformSlots];
+    bool slotsRead = false;
+    while (written < size) {
+        const uint8_t* buffer = m_renderRing.Front();
+        if (!buffer) break;
+        const size_t count = MIN(size - written, m_renderRing.SlotSize() - m_frontOffset);
+        memcpy(Data + written, buffer + m_frontOffset, count);
+        const auto& latched = m_renderLatched[m_renderRing.FrontIndex()];
+        if (!latched.empty()) {
+            if (!slotsRead) {
+                ReadLatchTransforms(slots);
+                slotsRead = true;
+            }
+            LatchSamples(latched, m_frontOffset, m_frontOffset + count, Data + written, slots);
+        }
+        written += count;
+        m_frontOffset += count;
+        if (m_frontOffset == m_renderRing.SlotSize()) {
+            m_renderRing.Pop();
+            m_frontOffset = 0;
+        }
     }
+    if (written < size) memset(Data + written, 0, size - written);
 
     // Notify sync if queue is running low.
-    if (m_writeIdx - m_readIdx < QUEUE_WATERMARK) SetEvent(m_frameEvent);
+    if (m_renderRing.Size() < QUEUE_WATERMARK) SetEvent(m_frameEvent);
 
     return S_OK;
 }
 
+void AudioGraphicsBuilder::ReadLatchTransforms(Transform* slots)
+{
+    // Called on the output side, which must not wait for the application
+    const Transform* latest = OutputTransformSlots();
+
+    // Samples have the device scale applied, the slot transform goes under it
+    const Transform device = DeviceTransform();
+    const Transform inverse = Transform::Scale(1.0f / m_xScale, 1.0f / m_yScale);
+    for (int slot = 0; slot < DisplayList::MaxTransformSlots; slot++) slots[slot] = device * latest[slot] * inverse;
+}
+
+void AudioGraphicsBuilder::SlotBases(Transform* bases) const
+{
+    // Samples have the device scale and the slot transforms of the prepared frame applied
+    const Transform device = DeviceTransform();
+    const Transform inverse = Transform::Scale(1.0f / m_xScale, 1.0f / m_yScale);
+    for (int slot = 0; slot < DisplayList::MaxTransformSlots; slot++) bases[slot] = device * m_preparedSlots[slot].Inverse() * inverse;
+}
+
+// Moves the samples on transform slots with the latest slot transforms, just before the buffer is played
+void AudioGraphicsBuilder::LatchSamples(const std::vector<LatchedSample>& latched, size_t begin, size_t end, uint8_t* data, const Transform* slots)
+{
+    for (const auto& s : latched) {
+        if (s.offset < begin) continue;
+        if (s.offset + m_wfx.nBlockAlign > end) break;
+        const Point p = slots[s.slot].Apply(s.p);
+        WriteSample(data + s.offset - begin, p.x, p.y);
+    }
+}
+
 void AudioGraphicsBuilder::Flush()
 {
-    m_readIdx = m_writeIdx = 0;
-    m_bufferIdx = 0;
+    // Called on the output side when it has stopped. Buffer that is being filled belongs to the encoder and is
+    // queued when it is full.
+    m_renderRing.Discard();
+    m_frontOffset = 0;
+    if (m_justInTime) {
+        // rest of a partly output primitive
+        m_frameSamples.clear();
+        m_jitOffset = 0;
+    }
 }
 
 }  // namespace AudioRender
@@ -0,0 +1,228 @@
+#include "pch.h"
+
+#include <cmath>
+
+#include "Clipper.hpp"
+#include "Parametric.hpp"
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+
+namespace AudioRender
+{
+// Points this close to the border are inside
+const float ClipEpsilon = 1e-6f;
+
+// Largest distance of the lines from a curve when a partially visible curve is flattened
+const float CurveFlatness = 0.0005f;
+
+struct ClipRect {
+    float xmin;
+    float ymin;
+    float xmax;
+    float ymax;
+
+    bool Inside(Point p) const
+    {
+        return p.x >= xmin - ClipEpsilon && p.x <= xmax + ClipEpsilon && p.y >= ymin - ClipEpsilon && p.y <= ymax + ClipEpsilon;
+    }
+};
+
+// Liang-Barsky. Returns false if the line is not visible, otherwise the visible part is [t0, t1].
+static bool clipLine(Point p0, Point p1, const ClipRect& r, float& t0, float& t1)
+{
+    const float dx = p1.x - p0.x;
+    const float dy = p1.y - p0.y;
+    const float p[4] = {-dx, dx, -dy, dy};
+    const float q[4] = {p0.x - r.xmin, r.xmax - p0.x, p0.y - r.ymin, r.ymax - p0.y};
+
+    t0 = 0;
+    t1 = 1;
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            // parallel to the edge
+            if (q[i] < 0) return false;
+            continue;
+        }
+        const float t = q[i] / p[i];
+        if (p[i] < 0) {
+            t0 = MAX(t0, t);
+        } else {
+            t1 = MIN(t1, t);
+        }
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+static inline Point circlePoint(const DisplayList::Primitive& p, float t)
+{
+    const float s = sinf(t);
+    const float c = cosf(t);
+    return {p.p.x + s * p.axisX.x + c * p.axisY.x, p.p.y + s * p.axisX.y + c * p.axisY.y};
+}
+
+// Angles where the circle crosses line x = k (or y = k). Circle coordinate is a * sin(t) + b * cos(t) + c.
+static int edgeCrossings(float a, float b, float c, float k, float* angles)
+{
+    // a * sin(t) + b * cos(t) = R * sin(t + phi)
+    const float R = sqrtf(a * a + b * b);
+    if (R == 0 || fabsf(k - c) > R) return 0;
+
+    const float phi = atan2f(b, a);
+    const float s = asinf((k - c) / R);
+    angles[0] = s - phi;
+    angles[1] = DisplayList::FullCircle / 2 - s - phi;
+    return 2;
+}
+
+// Writes visible intervals of the circle arc. Returns the number of intervals.
+static int clipCircle(const DisplayList::Primitive& p, const ClipRect& r, float (*arcs)[2])
+{
+    float crossings[8];
+    int count = 0;
+    count += edgeCrossings(p.axisX.x, p.axisY.x, p.p.x, r.xmin, crossings + count);
+    count += edgeCrossings(p.axisX.x, p.axisY.x, p.p.x, r.xmax, crossings + count);
+    count += edgeCrossings(p.axisX.y, p.axisY.y, p.p.y, r.ymin, crossings + count);
+    count += edgeCrossings(p.axisX.y, p.axisY.y, p.p.y, r.ymax, crossings + count);
+
+    // Crossings inside the drawn arc split it to intervals, angles are relative to the arc start
+    const float span = p.arcEnd - p.arcStart;
+    float angles[10];
+    int n = 0;
+    angles[n++] = 0;
+    for (int i = 0; i < count; i++) {
+        float t = fmodf(crossings[i] - p.arcStart, DisplayList::FullCircle);
+        if (t < 0) t += DisplayList::FullCircle;
+        if (t <= 0 || t >= span) continue;
+        // insertion sort, there are at most eight crossings
+        int j = n++;
+        for (; angles[j - 1] > t; j--) angles[j] = angles[j - 1];
+        angles[j] = t;
+    }
+    angles[n++] = span;
+
+    int arcCount = 0;
+    for (int i = 0; i + 1 < n; i++) {
+        const float t0 = angles[i];
+        const float t1 = angles[i + 1];
+        if (t1 - t0 < ClipEpsilon) continue;
+        if (!r.Inside(circlePoint(p, p.arcStart + (t0 + t1) / 2))) continue;
+
+        if (arcCount > 0 && arcs[arcCount - 1][1] == p.arcStart + t0) {
+            // continues previous interval, a tangent edge
+            arcs[arcCount - 1][1] = p.arcStart + t1;
+        } else {
+            arcs[arcCount][0] = p.arcStart + t0;
+            arcs[arcCount][1] = p.arcStart + t1;
+            arcCount++;
+        }
+    }
+
+    // Join the intervals over the start of a full circle
+    if (arcCount > 1 && !p.IsArc() && arcs[0][0] == p.arcStart && arcs[arcCount - 1][1] == p.arcEnd) {
+        arcs[0][0] = arcs[arcCount - 1][0] - DisplayList::FullCircle;
+        arcCount--;
+    }
+    return arcCount;
+}
+
+void ClipToRectangle(const DisplayList& list, const Rectangle& rect, DisplayList& out, FrameArena* arena, ParametricSampler* sampler)
+{
+    const ClipRect r{MIN(rect.left, rect.right), MIN(rect.top, rect.bottom), MAX(rect.left, rect.right), MAX(rect.top, rect.bottom)};
+
+    if (out.IsQuantized()) out.SetQuantized(false);
+    out.Clear(list.Origin());
+
+    // Current point of the output. Sync points are added only when drawing continues from elsewhere.
+    Point outPoint = list.Origin();
+    auto moveTo = [&](Point p) {
+        if (p.x != outPoint.x || p.y != outPoint.y) {
+            out.AddSync(p);
+            outPoint = p;
+        }
+    };
+
+    auto addLine = [&](Point p0, Point p1, float i0, float i1) {
+        float t0, t1;
+        if (!clipLine(p0, p1, r, t0, t1)) return;
+
+        const float dx = p1.x - p0.x;
+        const float dy = p1.y - p0.y;
+        const float di = i1 - i0;
+        const Point from = t0 > 0 ? Point{p0.x + t0 * dx, p0.y + t0 * dy} : p0;
+        const Point to = t1 < 1 ? Point{p0.x + t1 * dx, p0.y + t1 * dy} : p1;
+        moveTo(from);
+        out.AddLine(to, i0 + t0 * di, i0 + t1 * di);
+        outPoint = to;
+    };
+
+    // Own sampler allocates only when a parametric curve is clipped
+    ParametricSampler ownSampler;
+    if (!sampler) sampler = &ownSampler;
+
+    DisplayList::Reader reader(list, arena);
+    DisplayList::Primitive p;
+    while (reader.Next(p)) {
+        switch (p.type) {
+            case DisplayList::Primitive::Type::DRAW_SYNC:
+                // added when something visible is drawn from it
+                break;
+            case DisplayList::Primitive::Type::DRAW_LINE: addLine(p.p, p.toPoint, p.intensity, p.toIntensity); break;
+            case DisplayList::Primitive::Type::DRAW_CURVE: {
+                // Control points bound the curve
+                const float xmin = MIN(MIN(p.p.x, p.toPoint.x), MIN(p.control1.x, p.control2.x));
+                const float xmax = MAX(MAX(p.p.x, p.toPoint.x), MAX(p.control1.x, p.control2.x));
+                const float ymin = MIN(MIN(p.p.y, p.toPoint.y), MIN(p.control1.y, p.control2.y));
+                const float ymax = MAX(MAX(p.p.y, p.toPoint.y), MAX(p.control1.y, p.control2.y));
+                if (xmax < r.xmin || xmin > r.xmax || ymax < r.ymin || ymin > r.ymax) break;
+
+                if (r.Inside({xmin, ymin}) && r.Inside({xmax, ymax})) {
+                    moveTo(p.p);
+                    out.AddCubic(p.control1, p.control2, p.toPoint, p.intensity);
+                    outPoint = p.toPoint;
+                    break;
+                }
+                // partially visible curves are flattened to lines
+                const int segments = p.CurveSegments(CurveFlatness);
+                Point from = p.p;
+                for (int i = 1; i <= segments; i++) {
+                    const Point to = i < segments ? p.CurvePoint(float(i) / segments) : p.toPoint;
+                    addLine(from, to, p.intensity, p.intensity);
+                    from = to;
+                }
+            } break;
+            case DisplayList::Primitive::Type::DRAW_CIRCLE: {
+                float arcs[10][2];
+                const int count = clipCircle(p, r, arcs);
+                if (count == 1 && !p.IsArc() && arcs[0][1] - arcs[0][0] >= DisplayList::FullCircle) {
+                    // completely visible circle
+                    moveTo(p.p);
+                    out.AddEllipse(p.r, p.intensity, p.axisX, p.axisY);
+                    break;
+                }
+                for (int i = 0; i < count; i++) {
+                    moveTo(circlePoint(p, arcs[i][0]));
+                    out.AddArc(p.p, p.r, p.intensity, p.axisX, p.axisY, arcs[i][0], arcs[i][1]);
+                }
+                // arc does not end on the current point, next drawing needs a sync point
+                if (count > 0) outPoint = Point{NAN, NAN};
+            } break;
+            case DisplayList::Primitive::Type::DRAW_PARAMETRIC: {
+                const size_t count = sampler->Flatten(p, CurveFlatness);
+                const Point* points = sampler->Points();
+                bool inside = true;
+                for (size_t i = 0; i < count && inside; i++) inside = r.Inside(points[i]);
+                if (inside) {
+                    moveTo(points[0]);
+                    out.AddParametric(p);
+                    outPoint = Point{NAN, NAN};
+                    break;
+                }
+                // partially visible curves are clipped as lines
+                for (size_t i = 1; i < count; i++) addLine(points[i - 1], points[i], p.intensity, p.intensity);
+            } break;
+        }
+    }
+}
+}  // namespace AudioRender
@@ -0,0 +1,26 @@
+#include "pch.h"
+
+#include "CommandBuffer.hpp"
+#include "StrokeFont.hpp"
+
+namespace AudioRender
+{
+void CommandBuffer::DrawText(const char* text, Point position, float scale)
+{
+    const float unit = scale / StrokeFont::CapHeight;
+    Point pen = position;
+    for (; *text; text++) {
+        if (*text == '\n') {
+            pen = {position.x, pen.y + StrokeFont::LineHeight * unit};
+            continue;
+        }
+        if (*text != ' ') {
+            PushTransform(Transform::Translate(pen.x, pen.y) * Transform::Scale(unit));
+            FlushTransform();
+            StrokeFont::AddGlyph(*text, Intensity(), List());
+            PopTransform();
+        }
+        pen.x += StrokeFont::Advance * unit;
+    }
+}
+}  // namespace AudioRender
@@ -0,0 +1,751 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "DisplayList.hpp"
+#include "Parametric.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DISPLAYLIST_SSE2
+#endif
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define CLAMP(x, minx, maxx) MAX(minx, MIN(maxx, x))
+
+namespace AudioRender
+{
+static inline int16_t quantize(float c)
+{
+    long v = lroundf(c * DisplayList::QuantizationScale);
+    return (int16_t)CLAMP(v, -32768L, 32767L);
+}
+
+// Generations are unique across all lists so that a copied list can be identified
+static std::atomic<uint64_t> s_generationCounter = 0;
+
+uint64_t DisplayList::Seal()
+{
+    if (m_generation == 0) m_generation = ++s_generationCounter;
+    return m_generation;
+}
+
+void DisplayList::Clear(Point origin)
+{
+    m_generation = 0;
+    m_ops.clear();
+    m_vertices.clear();
+    m_qvertices.clear();
+    m_params.clear();
+    m_instances.clear();
+    m_curves.clear();
+    m_layer = 0;
+    m_layerMask = 1;
+    m_slot = -1;
+    m_slotMask = 0;
+    AddVertex(origin);
+}
+
+void DisplayList::SetQuantized(bool quantized)
+{
+    m_quantized = quantized;
+    Clear();
+}
+
+void DisplayList::Dequantize()
+{
+    if (!m_quantized) return;
+    m_vertices.resize(m_qvertices.size());
+    for (size_t i = 0; i < m_qvertices.size(); i++) m_vertices[i] = GetVertex(i);
+    m_qvertices.clear();
+    m_quantized = false;
+}
+
+void DisplayList::AddVertex(Point p)
+{
+    if (m_quantized) {
+        m_qvertices.push_back({quantize(p.x), quantize(p.y)});
+    } else {
+        m_vertices.push_back(p);
+    }
+}
+
+Point DisplayList::GetVertex(size_t idx) const
+{
+    if (m_quantized) {
+        const QPoint& q = m_qvertices[idx];
+        return {q.x / QuantizationScale, q.y / QuantizationScale};
+    }
+    return m_vertices[idx];
+}
+
+void DisplayList::AddSync(Point p)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::SYNC);
+    AddVertex(p);
+}
+
+void DisplayList::AddLine(Point to, float intensity)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::LINE);
+    AddVertex(to);
+    m_params.push_back(intensity);
+}
+
+void DisplayList::AddLine(Point to, float fromIntensity, float toIntensity)
+{
+    if (fromIntensity == toIntensity) {
+        AddLine(to, fromIntensity);
+        return;
+    }
+    m_generation = 0;
+    m_ops.push_back(Op::LINE_RAMP);
+    AddVertex(to);
+    m_params.push_back(fromIntensity);
+    m_params.push_back(toIntensity);
+}
+
+void DisplayList::AddCircle(float radius, float intensity)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::CIRCLE);
+    m_params.push_back(radius);
+    m_params.push_back(intensity);
+}
+
+void DisplayList::AddQuadratic(Point control, Point to, float intensity)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::QUAD);
+    AddVertex(control);
+    AddVertex(to);
+    m_params.push_back(intensity);
+}
+
+void DisplayList::AddCubic(Point control1, Point control2, Point to, float intensity)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::CUBIC);
+    AddVertex(control1);
+    AddVertex(control2);
+    AddVertex(to);
+    m_params.push_back(intensity);
+}
+
+void DisplayList::AddPolyline(const Point* points, size_t count, float intensity)
+{
+    m_generation = 0;
+    m_ops.insert(m_ops.end(), count, Op::LINE);
+    if (m_quantized) {
+        for (size_t i = 0; i < count; i++) m_qvertices.push_back({quantize(points[i].x), quantize(points[i].y)});
+    } else {
+        m_vertices.insert(m_vertices.end(), points, points + count);
+    }
+    m_params.insert(m_params.end(), count, intensity);
+}
+
+void DisplayList::AddEllipse(float radius, float intensity, Point axisX, Point axisY)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::ELLIPSE);
+    m_params.insert(m_params.end(), {radius, intensity, axisX.x, axisX.y, axisY.x, axisY.y});
+}
+
+void DisplayList::AddArc(Point center, float radius, float intensity, Point axisX, Point axisY, float start, float end)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::ARC);
+    m_params.insert(m_params.end(), {center.x, center.y, radius, intensity, axisX.x, axisX.y, axisY.x, axisY.y, start, end});
+}
+
+void DisplayList::AddCircle(const Primitive& p)
+{
+    if (p.IsArc()) {
+        AddArc(p.p, p.r, p.intensity, p.axisX, p.axisY, p.arcStart, p.arcEnd);
+    } else {
+        AddEllipse(p.r, p.intensity, p.axisX, p.axisY);
+    }
+}
+
+void DisplayList::AddParametric(std::shared_ptr<const ParametricCurve> curve, float start, float end, float intensity, const Transform& t)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::PARAMETRIC);
+    m_params.insert(m_params.end(), {intensity, start, end, t.a, t.b, t.c, t.d, t.tx, t.ty});
+    m_curves.push_back(std::move(curve));
+}
+
+void DisplayList::AddParametric(const Primitive& p)
+{
+    AddParametric(p.curve->shared_from_this(), p.arcStart, p.arcEnd, p.intensity, p.curveTransform);
+}
+
+void DisplayList::SetClipping(bool clipping)
+{
+    if (clipping != m_clipping) m_generation = 0;
+    m_clipping = clipping;
+}
+
+void DisplayList::AddTransform(const Transform& t)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::TRANSFORM);
+    m_params.insert(m_params.end(), {t.a, t.b, t.c, t.d, t.tx, t.ty});
+}
+
+void DisplayList::AddInstance(std::shared_ptr<const DisplayList> shape, const Transform& t, float intensity)
+{
+    m_generation = 0;
+    m_ops.push_back(Op::INSTANCE);
+    m_params.insert(m_params.end(), {t.a, t.b, t.c, t.d, t.tx, t.ty, sqrtf(fabsf(t.Determinant())), intensity});
+    m_instances.push_back(std::move(shape));
+}
+
+void DisplayList::AddLayer(int layer)
+{
+    layer = CLAMP(layer, 0, MaxLayers - 1);
+    if (layer == m_layer) return;
+    m_generation = 0;
+    m_ops.push_back(Op::LAYER);
+    m_params.push_back(float(layer));
+    m_layer = layer;
+    m_layerMask |= 1u << layer;
+}
+
+void DisplayList::AddSlot(int slot)
+{
+    slot = CLAMP(slot, -1, MaxTransformSlots - 1);
+    if (slot == m_slot) return;
+    m_generation = 0;
+    m_ops.push_back(Op::SLOT);
+    m_params.push_back(float(slot));
+    m_slot = slot;
+    if (slot >= 0) m_slotMask |= 1u << slot;
+}
+
+// Transforms points in place or to another array
+static void transformPoints(const Transform& t, Point* points, size_t count)
+{
+    size_t i = 0;
+#ifdef DISPLAYLIST_SSE2
+    // two points per register: x0 y0 x1 y1
+    const __m128 m0 = _mm_setr_ps(t.a, t.b, t.a, t.b);
+    const __m128 m1 = _mm_setr_ps(t.c, t.d, t.c, t.d);
+    const __m128 tr = _mm_setr_ps(t.tx, t.ty, t.tx, t.ty);
+    float* data = reinterpret_cast<float*>(points);
+    for (; i + 2 <= count; i += 2) {
+        const __m128 v = _mm_loadu_ps(data + i * 2);
+        const __m128 xx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 yy = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+        _mm_storeu_ps(data + i * 2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, m0), _mm_mul_ps(yy, m1)), tr));
+    }
+#endif
+    for (; i < count; i++) points[i] = t.Apply(points[i]);
+}
+
+static inline Point transformAxis(const Transform& t, Point axis) { return {t.a * axis.x + t.c * axis.y, t.b * axis.x + t.d * axis.y}; }
+
+void DisplayList::ResolveTransforms(const Transform& device, DisplayList& out, const Transform* slots, bool keepSlots) const
+{
+    static_assert(sizeof(Point) == 2 * sizeof(float), "Point must be two packed floats");
+
+    out.m_quantized = false;
+    out.m_clipping = m_clipping;
+    out.m_generation = 0;
+    out.m_ops.clear();
+    out.m_params.clear();
+    out.m_qvertices.clear();
+    out.m_instances = m_instances;
+    out.m_curves = m_curves;
+    out.m_layer = m_layer;
+    out.m_layerMask = m_layerMask;
+    keepSlots = keepSlots || !slots;
+    out.m_slot = keepSlots ? m_slot : -1;
+    out.m_slotMask = keepSlots ? m_slotMask : 0;
+
+    const size_t vertexCount = m_quantized ? m_qvertices.size() : m_vertices.size();
+    if (m_quantized) {
+        out.m_vertices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) out.m_vertices[i] = GetVertex(i);
+    } else {
+        out.m_vertices = m_vertices;
+    }
+
+    // Vertices are transformed in runs that share the same transform
+    Transform t = device;
+    Transform user;
+    Transform slot;
+    float radiusScale = 1.0f;
+    size_t runStart = 0;
+    size_t vertex = 1;  // origin
+    size_t param = 0;
+    for (Op op : m_ops) {
+        switch (op) {
+            case Op::SYNC:
+                out.m_ops.push_back(op);
+                vertex++;
+                break;
+            case Op::LINE:
+                out.m_ops.push_back(op);
+                out.m_params.push_back(m_params[param++]);
+                vertex++;
+                break;
+            case Op::LINE_RAMP:
+                out.m_ops.push_back(op);
+                out.m_params.push_back(m_params[param++]);
+                out.m_params.push_back(m_params[param++]);
+                vertex++;
+                break;
+            case Op::QUAD:
+                out.m_ops.push_back(op);
+                out.m_params.push_back(m_params[param++]);
+                vertex += 2;
+                break;
+            case Op::CUBIC:
+                out.m_ops.push_back(op);
+                out.m_params.push_back(m_params[param++]);
+                vertex += 3;
+                break;
+            case Op::CIRCLE: {
+                const float r = m_params[param++];
+                const float intensity = m_params[param++];
+                out.AddEllipse(r * radiusScale, intensity, transformAxis(t, {r, 0}), transformAxis(t, {0, r}));
+            } break;
+            case Op::ELLIPSE: {
+                const float r = m_params[param++];
+                const float intensity = m_params[param++];
+                const Point axisX{m_params[param], m_params[param + 1]};
+                const Point axisY{m_params[param + 2], m_params[param + 3]};
+                param += 4;
+                out.AddEllipse(r * radiusScale, intensity, transformAxis(t, axisX), transformAxis(t, axisY));
+            } break;
+            case Op::ARC: {
+                const float* params = &m_params[param];
+                param += 10;
+                out.AddArc(t.Apply({params[0], params[1]}), params[2] * radiusScale, params[3], transformAxis(t, {params[4], params[5]}),
+                    transformAxis(t, {params[6], params[7]}), params[8], params[9]);
+            } break;
+            case Op::TRANSFORM: {
+                transformPoints(t, out.m_vertices.data() + runStart, vertex - runStart);
+                runStart = vertex;
+
+                user = {m_params[param], m_params[param + 1], m_params[param + 2], m_params[param + 3], m_params[param + 4], m_params[param + 5]};
+                param += 6;
+                t = device * slot * user;
+                radiusScale = sqrtf(fabsf((slot * user).Determinant()));
+            } break;
+            case Op::SLOT: {
+                const int index = int(m_params[param++]);
+                if (keepSlots) {
+                    out.m_ops.push_back(op);
+                    out.m_params.push_back(float(index));
+                }
+                if (!slots) break;
+                transformPoints(t, out.m_vertices.data() + runStart, vertex - runStart);
+                runStart = vertex;
+                slot = index >= 0 ? slots[index] : Transform{};
+                t = device * slot * user;
+                radiusScale = sqrtf(fabsf((slot * user).Determinant()));
+            } break;
+            case Op::INSTANCE: {
+                // shape keeps its own vertices, transforms are combined
+                const float* params = &m_params[param];
+                param += 8;
+                const Transform instance = t * Transform{params[0], params[1], params[2], params[3], params[4], params[5]};
+                out.m_ops.push_back(op);
+                out.m_params.insert(out.m_params.end(),
+                    {instance.a, instance.b, instance.c, instance.d, instance.tx, instance.ty, params[6] * radiusScale, params[7]});
+            } break;
+            case Op::LAYER:
+                out.m_ops.push_back(op);
+                out.m_params.push_back(m_params[param++]);
+                break;
+            case Op::PARAMETRIC: {
+                const float* params = &m_params[param];
+                param += 9;
+                const Transform curve = t * Transform{params[3], params[4], params[5], params[6], params[7], params[8]};
+                out.m_ops.push_back(op);
+                out.m_params.insert(out.m_params.end(), {params[0], params[1], params[2], curve.a, curve.b, curve.c, curve.d, curve.tx, curve.ty});
+            } break;
+        }
+    }
+    transformPoints(t, out.m_vertices.data() + runStart, vertexCount - runStart);
+}
+
+// Number of vertices and parameters used by a command
+static void commandSize(DisplayList::Op op, size_t& vertices, size_t& params)
+{
+    using Op = DisplayList::Op;
+    switch (op) {
+        case Op::SYNC: vertices = 1, params = 0; break;
+        case Op::LINE: vertices = 1, params = 1; break;
+        case Op::LINE_RAMP: vertices = 1, params = 2; break;
+        case Op::CIRCLE: vertices = 0, params = 2; break;
+        case Op::ELLIPSE: vertices = 0, params = 6; break;
+        case Op::TRANSFORM: vertices = 0, params = 6; break;
+        case Op::ARC: vertices = 0, params = 10; break;
+        case Op::QUAD: vertices = 2, params = 1; break;
+        case Op::CUBIC: vertices = 3, params = 1; break;
+        case Op::INSTANCE: vertices = 0, params = 8; break;
+        case Op::LAYER: vertices = 0, params = 1; break;
+        case Op::PARAMETRIC: vertices = 0, params = 9; break;
+        case Op::SLOT: vertices = 0, params = 1; break;
+    }
+}
+
+// Commands that are drawn from the current point
+static bool drawsFromCurrentPoint(DisplayList::Op op)
+{
+    using Op = DisplayList::Op;
+    return op == Op::LINE || op == Op::LINE_RAMP || op == Op::CIRCLE || op == Op::ELLIPSE || op == Op::QUAD || op == Op::CUBIC;
+}
+
+void DisplayList::ExtractLayer(int layer, int slot, DisplayList& out) const
+{
+    if (out.IsQuantized() != m_quantized) out.SetQuantized(m_quantized);
+    out.Clear(Origin());
+    out.m_clipping = m_clipping;
+
+    int current = 0;
+    int currentSlot = -1;
+    Point currPoint = Origin();  // current point of this list
+    Point outPoint = currPoint;  // current point of the extracted list
+    size_t vertex = 1;
+    size_t param = 0;
+    size_t instance = 0;
+    size_t curve = 0;
+    for (Op op : m_ops) {
+        size_t vertices = 0, params = 0;
+        commandSize(op, vertices, params);
+
+        if (op == Op::LAYER) {
+            current = int(m_params[param]);
+        } else if (op == Op::SLOT) {
+            currentSlot = int(m_params[param]);
+        } else if (current == layer && currentSlot == slot) {
+            if (drawsFromCurrentPoint(op) && (currPoint.x != outPoint.x || currPoint.y != outPoint.y)) out.AddSync(currPoint);
+            out.m_ops.push_back(op);
+            for (size_t i = 0; i < vertices; i++) out.AddVertex(GetVertex(vertex + i));
+            out.m_params.insert(out.m_params.end(), m_params.begin() + param, m_params.begin() + param + params);
+            if (op == Op::INSTANCE) out.m_instances.push_back(m_instances[instance]);
+            if (op == Op::PARAMETRIC) out.m_curves.push_back(m_curves[curve]);
+            if (vertices) outPoint = GetVertex(vertex + vertices - 1);
+        }
+        if (op == Op::INSTANCE) instance++;
+        if (op == Op::PARAMETRIC) curve++;
+        if (vertices) currPoint = GetVertex(vertex + vertices - 1);
+        vertex += vertices;
+        param += params;
+    }
+}
+
+void DisplayList::Append(const DisplayList& other)
+{
+    if (other.Empty()) return;
+
+    m_generation = 0;
+    // Vertices of other can be in the units of its transforms, which the quantized range would clamp
+    if (m_quantized && std::any_of(other.m_ops.begin(), other.m_ops.end(), [](Op op) { return op == Op::TRANSFORM || op == Op::SLOT; })) {
+        Dequantize();
+    }
+    const Point origin = other.Origin();
+    const Point last = GetVertex((m_quantized ? m_qvertices.size() : m_vertices.size()) - 1);
+    if (drawsFromCurrentPoint(other.m_ops[0]) && (origin.x != last.x || origin.y != last.y)) AddSync(origin);
+
+    m_ops.insert(m_ops.end(), other.m_ops.begin(), other.m_ops.end());
+    const size_t vertexCount = other.m_quantized ? other.m_qvertices.size() : other.m_vertices.size();
+    for (size_t i = 1; i < vertexCount; i++) AddVertex(other.GetVertex(i));
+    m_params.insert(m_params.end(), other.m_params.begin(), other.m_params.end());
+    m_instances.insert(m_instances.end(), other.m_instances.begin(), other.m_instances.end());
+    m_curves.insert(m_curves.end(), other.m_curves.begin(), other.m_curves.end());
+    // commands before the first layer command of other stay on the current layer
+    if (other.m_layerMask != 1) {
+        m_layer = other.m_layer;
+        m_layerMask |= other.m_layerMask;
+    }
+    // and on the current slot
+    if (other.m_slotMask) {
+        m_slot = other.m_slot;
+        m_slotMask |= other.m_slotMask;
+    }
+}
+
+int DisplayList::Primitive::CurveSegments(float tolerance) const
+{
+    // Wang's formula, bound of the second differences of the control points
+    const float ddx = MAX(fabsf(p.x - 2 * control1.x + control2.x), fabsf(control1.x - 2 * control2.x + toPoint.x));
+    const float ddy = MAX(fabsf(p.y - 2 * control1.y + control2.y), fabsf(control1.y - 2 * control2.y + toPoint.y));
+    const float dd = sqrtf(ddx * ddx + ddy * ddy);
+    return MAX(1, (int)ceilf(sqrtf(0.75f * dd / tolerance)));
+}
+
+size_t DisplayList::ByteSize() const
+{
+    return m_ops.size() * sizeof(Op) + m_vertices.size() * sizeof(Point) + m_qvertices.size() * sizeof(QPoint) + m_params.size() * sizeof(float) +
+           m_instances.size() * sizeof(std::shared_ptr<const DisplayList>) + m_curves.size() * sizeof(std::shared_ptr<const ParametricCurve>);
+}
+
+DisplayList::Reader::Reader(const DisplayList& list, FrameArena* arena)
+    : m_list(&list)
+    , m_arena(arena)
+{
+    // First vertex is the starting point set on Clear
+    m_currPoint = m_list->GetVertex(m_vertex++);
+}
+
+DisplayList::Reader::Reader(const Instance& instance, FrameArena* arena)
+    : m_arena(arena)
+{
+    Start(instance);
+}
+
+DisplayList::Reader::~Reader()
+{
+    if (!m_nested) return;
+    if (m_arena) {
+        m_nested->~Reader();
+    } else {
+        delete m_nested;
+    }
+}
+
+void DisplayList::Reader::Restart(const DisplayList& list)
+{
+    Start({std::shared_ptr<const DisplayList>(std::shared_ptr<const DisplayList>(), &list), Transform{}, 1.0f, -1});
+}
+
+void DisplayList::Reader::Start(const Instance& instance)
+{
+    m_list = instance.shape.get();
+    m_op = 0;
+    m_vertex = 0;
+    m_param = 0;
+    m_instance = 0;
+    m_curve = 0;
+    m_transform = instance.transform;
+    m_transformed = !instance.transform.IsIdentity();
+    m_radiusScale = instance.radiusScale;
+    m_layer = 0;
+    m_slot = -1;
+    m_base = instance.transform;
+    m_baseRadiusScale = instance.radiusScale;
+    m_intensity = instance.intensity;
+    m_nestedActive = false;
+    m_position = Position::None;
+    m_currPoint = NextVertex();
+}
+
+void DisplayList::Reader::ReadPositions(const DisplayList& list, std::vector<Position>& positions, std::vector<size_t>& primitives,
+                                        FrameArena* arena)
+{
+    positions.clear();
+    primitives.clear();
+    Reader reader(list, arena);
+    primitives.push_back(reader.AddPosition(positions, Position::None));
+    Primitive p;
+    while (reader.Next(p)) primitives.push_back(reader.AddPosition(positions, Position::None));
+}
+
+size_t DisplayList::Reader::AddPosition(std::vector<Position>& positions, size_t outer)
+{
+    // Reader has not moved if it has not read a command since, and it has not been started for another instance
+    if (m_position == Position::None || positions[m_position].op != m_op || positions[m_position].outer != outer) {
+        m_position = positions.size();
+        positions.push_back({m_list, m_op, m_vertex, m_param, m_instance, m_curve, m_currPoint, m_transform, m_transformed, m_radiusScale,
+                             m_layer, m_slot, m_base, m_baseRadiusScale, m_intensity, outer});
+    }
+    return m_nestedActive ? m_nested->AddPosition(positions, m_position) : m_position;
+}
+
+void DisplayList::Reader::Seek(const std::vector<Position>& positions, size_t index) { SeekLevel(positions, index); }
+
+DisplayList::Reader* DisplayList::Reader::SeekLevel(const std::vector<Position>& positions, size_t index)
+{
+    const Position& position = positions[index];
+    Reader* reader = this;
+    if (position.outer != Position::None) {
+        // Enclosing readers are set up first, the instance is read by the nested reader of the enclosing one
+        Reader* outer = SeekLevel(positions, position.outer);
+        if (!outer->m_nested) {
+            outer->m_nested = outer->m_arena ? outer->m_arena->New<Reader>(*position.list, outer->m_arena) : new Reader(*position.list);
+        }
+        outer->m_nestedActive = true;
+        reader = outer->m_nested;
+    }
+    reader->m_list = position.list;
+    reader->m_op = position.op;
+    reader->m_vertex = position.vertex;
+    reader->m_param = position.param;
+    reader->m_instance = position.instance;
+    reader->m_curve = position.curve;
+    reader->m_currPoint = position.currPoint;
+    reader->m_transform = position.transform;
+    reader->m_transformed = position.transformed;
+    reader->m_radiusScale = position.radiusScale;
+    reader->m_layer = position.layer;
+    reader->m_slot = position.slot;
+    reader->m_base = position.base;
+    reader->m_baseRadiusScale = position.baseRadiusScale;
+    reader->m_intensity = position.intensity;
+    reader->m_nestedActive = false;
+    reader->m_position = Position::None;
+    return reader;
+}
+
+Point DisplayList::Reader::NextVertex()
+{
+    const Point p = m_list->GetVertex(m_vertex++);
+    return m_transformed ? m_transform.Apply(p) : p;
+}
+
+void DisplayList::Reader::ReadState()
+{
+    // Transform, layer and slot commands only change the state of the reader
+    while (m_op < m_list->m_ops.size() &&
+           (m_list->m_ops[m_op] == Op::TRANSFORM || m_list->m_ops[m_op] == Op::LAYER || m_list->m_ops[m_op] == Op::SLOT)) {
+        if (m_list->m_ops[m_op] == Op::LAYER) {
+            m_layer = int(m_list->m_params[m_param++]);
+            m_op++;
+            continue;
+        }
+        if (m_list->m_ops[m_op] == Op::SLOT) {
+            m_slot = int(m_list->m_params[m_param++]);
+            m_op++;
+            continue;
+        }
+        const float* params = &m_list->m_params[m_param];
+        const Transform t{params[0], params[1], params[2], params[3], params[4], params[5]};
+        m_transform = m_base * t;
+        m_transformed = !m_transform.IsIdentity();
+        m_radiusScale = m_baseRadiusScale * sqrtf(fabsf(t.Determinant()));
+        m_param += 6;
+        m_op++;
+    }
+}
+
+DisplayList::Reader::Instance DisplayList::Reader::ReadInstance()
+{
+    const float* params = &m_list->m_params[m_param];
+    m_param += 8;
+    m_op++;
+    const Transform t{params[0], params[1], params[2], params[3], params[4], params[5]};
+    // intensity of an outer instance wins
+    return {m_list->m_instances[m_instance++], m_transform * t, m_radiusScale * params[6], m_intensity >= 0 ? m_intensity : params[7]};
+}
+
+bool DisplayList::Reader::NextInstance(Instance& instance)
+{
+    if (m_nestedActive) return false;
+    ReadState();
+    if (m_op >= m_list->m_ops.size() || m_list->m_ops[m_op] != Op::INSTANCE) return false;
+    instance = ReadInstance();
+    return true;
+}
+
+bool DisplayList::Reader::Next(Primitive& p)
+{
+    for (;;) {
+        if (m_nestedActive) {
+            if (m_nested->Next(p)) return true;
+            m_nestedActive = false;
+        }
+        ReadState();
+        if (m_op >= m_list->m_ops.size()) return false;
+        if (m_list->m_ops[m_op] != Op::INSTANCE) break;
+
+        const Instance instance = ReadInstance();
+        if (m_nested) {
+            m_nested->Start(instance);
+        } else {
+            m_nested = m_arena ? m_arena->New<Reader>(instance, m_arena) : new Reader(instance);
+        }
+        m_nestedActive = true;
+    }
+
+    switch (m_list->m_ops[m_op++]) {
+        case Op::SYNC:
+            m_currPoint = NextVertex();
+            p = {Primitive::Type::DRAW_SYNC, -1, 0, 0, m_currPoint, m_currPoint};
+            break;
+        case Op::LINE: {
+            const float intensity = m_list->m_params[m_param++];
+            const Point from = m_currPoint;
+            m_currPoint = NextVertex();
+            p = {Primitive::Type::DRAW_LINE, -1, intensity, intensity, from, m_currPoint};
+        } break;
+        case Op::LINE_RAMP: {
+            const float fromIntensity = m_list->m_params[m_param++];
+            const float toIntensity = m_list->m_params[m_param++];
+            const Point from = m_currPoint;
+            m_currPoint = NextVertex();
+            p = {Primitive::Type::DRAW_LINE, -1, fromIntensity, toIntensity, from, m_currPoint};
+        } break;
+        case Op::QUAD: {
+            const float intensity = m_list->m_params[m_param++];
+            const Point from = m_currPoint;
+            const Point control = NextVertex();
+            m_currPoint = NextVertex();
+            // degree elevation, the cubic curve has the same shape
+            p = {Primitive::Type::DRAW_CURVE, -1, intensity, intensity, from, m_currPoint};
+            p.control1 = {from.x + 2.0f / 3 * (control.x - from.x), from.y + 2.0f / 3 * (control.y - from.y)};
+            p.control2 = {m_currPoint.x + 2.0f / 3 * (control.x - m_currPoint.x), m_currPoint.y + 2.0f / 3 * (control.y - m_currPoint.y)};
+        } break;
+        case Op::CUBIC: {
+            const float intensity = m_list->m_params[m_param++];
+            const Point from = m_currPoint;
+            const Point control1 = NextVertex();
+            const Point control2 = NextVertex();
+            m_currPoint = NextVertex();
+            p = {Primitive::Type::DRAW_CURVE, -1, intensity, intensity, from, m_currPoint};
+            p.control1 = control1;
+            p.control2 = control2;
+        } break;
+        case Op::CIRCLE: {
+            const float r = m_list->m_params[m_param++];
+            const float intensity = m_list->m_params[m_param++];
+            p = {Primitive::Type::DRAW_CIRCLE, r, intensity, intensity, m_currPoint, m_currPoint, {r, 0}, {0, r}, 0, FullCircle};
+        } break;
+        case Op::ELLIPSE: {
+            const float* params = &m_list->m_params[m_param];
+            m_param += 6;
+            p = {Primitive::Type::DRAW_CIRCLE, params[0], params[1], params[1], m_currPoint, m_currPoint, {params[2], params[3]},
+                {params[4], params[5]}, 0, FullCircle};
+        } break;
+        case Op::ARC: {
+            const float* params = &m_list->m_params[m_param];
+            m_param += 10;
+            Point center{params[0], params[1]};
+            if (m_transformed) center = m_transform.Apply(center);
+            p = {Primitive::Type::DRAW_CIRCLE, params[2], params[3], params[3], center, center, {params[4], params[5]}, {params[6], params[7]},
+                params[8], params[9]};
+        } break;
+        case Op::PARAMETRIC: {
+            const float* params = &m_list->m_params[m_param];
+            m_param += 9;
+            const Transform t{params[3], params[4], params[5], params[6], params[7], params[8]};
+            p = {Primitive::Type::DRAW_PARAMETRIC, -1, params[0], params[0], m_currPoint, m_currPoint, {}, {}, params[1], params[2]};
+            p.curve = m_list->m_curves[m_curve++].get();
+            p.curveTransform = m_transformed ? m_transform * t : t;
+        } break;
+        case Op::TRANSFORM:
+        case Op::INSTANCE:
+        case Op::LAYER:
+        case Op::SLOT: break;
+    }
+    if (p.type == Primitive::Type::DRAW_CIRCLE) {
+        p.r *= m_radiusScale;
+        if (m_transformed) {
+            p.axisX = transformAxis(m_transform, p.axisX);
+            p.axisY = transformAxis(m_transform, p.axisY);
+        }
+    }
+    if (m_intensity >= 0 && p.type != Primitive::Type::DRAW_SYNC) p.intensity = p.toIntensity = m_intensity;
+    return true;
+}
+
+}  // namespace AudioRender
@@ -1,39 +1,364 @@
 #include "pch.h"
 
+#include <algorithm>
+
 #include "DrawDevice.hpp"
+#include "StrokeFont.hpp"
 
 namespace AudioRender
 {
 void DrawDevice::Begin()
 {
-    m_operations.clear();
-    m_currIntensity = DefaultIntensity;
-    m_currPoint = Point{0};
+    DisplayList& list = m_recorder.List();
+    if (list.IsQuantized() != m_quantizeVertices) list.SetQuantized(m_quantizeVertices);
+    m_recorder.Reset();
+    list.SetClipping(m_clipping);
+}
+
+void DrawDevice::DrawCircle(float radius) { m_recorder.DrawCircle(radius); }
+
+void DrawDevice::DrawLine(Point to, float intensity) { m_recorder.DrawLine(to, intensity); }
+
+void DrawDevice::DrawQuadratic(Point control, Point to) { m_recorder.DrawQuadratic(control, to); }
+
+void DrawDevice::DrawCubic(Point control1, Point control2, Point to) { m_recorder.DrawCubic(control1, control2, to); }
+
+void DrawDevice::DrawArc(Point center, float radius, float startAngle, float endAngle)
+{
+    m_recorder.DrawArc(center, radius, startAngle, endAngle);
+}
+
+void DrawDevice::DrawPolyline(const Point* points, size_t count, bool closed) { m_recorder.DrawPolyline(points, count, closed); }
+
+void DrawDevice::DrawPaths(const Point* points, const size_t* counts, size_t pathCount, bool closed)
+{
+    m_recorder.DrawPaths(points, counts, pathCount, closed);
+}
+
+void DrawDevice::DrawParametric(std::shared_ptr<const ParametricCurve> curve, float t0, float t1)
+{
+    m_recorder.DrawParametric(std::move(curve), t0, t1);
+}
+
+void DrawDevice::BeginShape()
+{
+    if (m_recordingShape) return;
+    m_recordingShape = true;
+
+    // shapes are not quantized as they are drawn in their own coordinates
+    m_frameRecorder = std::move(m_recorder);
+    m_recorder = ListRecorder{};
+}
+
+int DrawDevice::EndShape()
+{
+    if (!m_recordingShape) return -1;
+    m_recordingShape = false;
+
+    m_shapes.push_back(std::make_shared<const DisplayList>(std::move(m_recorder.List())));
+    m_recorder = std::move(m_frameRecorder);
+    return int(m_shapes.size() - 1);
+}
+
+void DrawDevice::DrawInstance(int shape, const Transform& t, float intensity)
+{
+    if (shape < 0 || size_t(shape) >= m_shapes.size()) return;
+    m_recorder.DrawInstance(m_shapes[shape], t, intensity);
+}
+
+std::shared_ptr<const DisplayList> DrawDevice::GetShape(int shape) const
+{
+    if (shape < 0 || size_t(shape) >= m_shapes.size()) return nullptr;
+    return m_shapes[shape];
+}
+
+void DrawDevice::SubmitCommandBuffers(const CommandBuffer* const* buffers, size_t count)
+{
+    DisplayList& list = m_recorder.List();
+    for (size_t i = 0; i < count; i++) {
+        const DisplayList& commands = buffers[i]->Commands();
+        if (commands.Empty()) continue;
+        // buffers start on layer 0 without a slot and with identity transform whatever the frame has before them
+        list.AddLayer(0);
+        list.AddSlot(-1);
+        list.AddTransform(Transform{});
+        list.Append(commands);
+    }
+    // primitives drawn after this are on the transform set on the device
+    m_recorder.InvalidateTransform();
+    Submit();
+}
+
+void DrawDevice::DrawText(const char* text, Point position, float scale)
+{
+    // Each glyph is a shape, so the encoder can reuse its samples wherever the glyph is drawn at the same scale
+    if (m_glyphShapes.empty()) m_glyphShapes.assign(256, -1);
+
+    const float unit = scale / StrokeFont::CapHeight;
+    const Transform glyphScale = Transform::Scale(unit);
+    Point pen = position;
+    for (; *text; text++) {
+        const unsigned char c = *text;
+        if (c == '\n') {
+            pen = {position.x, pen.y + StrokeFont::LineHeight * unit};
+            continue;
+        }
+        if (c != ' ') {
+            int& shape = m_glyphShapes[c];
+            if (shape < 0) {
+                auto glyph = std::make_shared<DisplayList>();
+                StrokeFont::AddGlyph(char(c), DefaultIntensity, *glyph);
+                m_shapes.push_back(std::move(glyph));
+                shape = int(m_shapes.size() - 1);
+            }
+            DrawDevice::DrawInstance(shape, Transform::Translate(pen.x, pen.y) * glyphScale, m_recorder.Intensity());
+        }
+        pen.x += StrokeFont::Advance * unit;
+    }
+}
+
+void DrawDevice::SetIntensity(float intensity) { m_recorder.SetIntensity(intensity); }
+
+void DrawDevice::SetPoint(Point p) { m_recorder.SetPoint(p); }
+
+void DrawDevice::SetTransform(const Transform& t) { m_recorder.SetTransform(t); }
+
+void DrawDevice::PushTransform(const Transform& t) { m_recorder.PushTransform(t); }
+
+void DrawDevice::PopTransform() { m_recorder.PopTransform(); }
+
+void DrawDevice::SetLayer(int layer)
+{
+    // layers are a property of the frame
+    if (m_recordingShape) return;
+    m_recorder.SetLayer(layer);
+}
+
+void DrawDevice::SetTransformSlot(int slot)
+{
+    // like layers, slots are a property of the frame
+    if (m_recordingShape) return;
+    m_recorder.SetTransformSlot(slot);
 }
 
-void DrawDevice::DrawCircle(float radius)
+void DrawDevice::UpdateTransformSlot(int slot, const Transform& t)
 {
-    GraphicsPrimitive op{GraphicsPrimitive::Type::DRAW_CIRCLE, radius, m_currIntensity, m_currPoint, m_currPoint};
-    m_operations.emplace_back(op);
+    if (slot < 0 || slot >= DisplayList::MaxTransformSlots) return;
+
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    m_slotTransforms[slot] = t;
+    m_slotVersion++;
+
+    std::copy(std::begin(m_slotTransforms), std::end(m_slotTransforms), m_slotTables[m_slotBack]);
+    m_slotBack = m_slotPublished.exchange(m_slotBack | NewSlotsFlag, std::memory_order_acq_rel) & ~NewSlotsFlag;
+}
+
+uint32_t DrawDevice::ReadTransformSlots(Transform* slots)
+{
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    for (int slot = 0; slot < DisplayList::MaxTransformSlots; slot++) slots[slot] = m_slotTransforms[slot];
+    return m_slotVersion;
+}
+
+const Transform* DrawDevice::OutputTransformSlots()
+{
+    if (m_slotPublished.load(std::memory_order_acquire) & NewSlotsFlag) {
+        m_slotFront = m_slotPublished.exchange(m_slotFront, std::memory_order_acq_rel) & ~NewSlotsFlag;
+    }
+    return m_slotTables[m_slotFront];
+}
+
+void DrawDevice::SetClipping(bool enabled)
+{
+    m_clipping = enabled;
+    m_recorder.List().SetClipping(enabled);
+}
+
+void DrawDevice::RecordList(const char* name)
+{
+    // sealing first lets the replayed copies share the generation with the current list
+    m_recorder.List().Seal();
+    m_recordedLists[name] = m_recorder.List();
+}
+
+bool DrawDevice::ReplayList(const char* name)
+{
+    auto it = m_recordedLists.find(name);
+    if (it == m_recordedLists.end()) return false;
+
+    m_recorder.List() = it->second;
+    m_recorder.List().SetClipping(m_clipping);
+    m_recorder.SetIntensity(DefaultIntensity);
+    // replayed list may end with another transform
+    m_recorder.InvalidateTransform();
+    return true;
+}
+
+void DrawDevice::setPathOptimization(bool enabled, float budgetMs)
+{
+    m_pathOptimization = enabled;
+    m_pathOptimizationBudgetMs = budgetMs;
+    m_preparedGeneration = 0;
+}
+
+void DrawDevice::setLayerRefreshDivisor(int layer, int divisor)
+{
+    if (layer < 0 || layer >= DisplayList::MaxLayers) return;
+    m_layerDivisors[layer] = divisor;
 }
 
-void DrawDevice::DrawLine(Point to, float intensity)
+void DrawDevice::setSimplification(bool enabled, float tolerance)
 {
-    float fromIntensity = m_currIntensity;
-    if (intensity >= 0) m_currIntensity = intensity;
-    Point fromPoint = m_currPoint;
-    m_currPoint = to;
-    GraphicsPrimitive op{GraphicsPrimitive::Type::DRAW_LINE, -1, fromIntensity, fromPoint, m_currPoint};
-    m_operations.emplace_back(op);
+    m_simplification = enabled;
+    m_simplificationTolerance = tolerance;
+    m_preparedGeneration = 0;
 }
 
-void DrawDevice::SetIntensity(float intensity) { m_currIntensity = intensity; }
+DisplayList& DrawDevice::PrepareFrame(DisplayList& list)
+{
+    // Slot transforms are resolved here, so that the passes work in output units. Devices that latch the slots
+    // apply the change since then to their output.
+    const bool resolveSlots = list.Slots() != 0;
+    const bool latchSlots = resolveSlots && LatchesTransformSlots();
+    Transform slots[DisplayList::MaxTransformSlots];
+    const uint32_t slotVersion = resolveSlots ? ReadTransformSlots(slots) : 0;
+    if (latchSlots) {
+        // the change is applied to the resolved geometry, which a collapsed slot would lose
+        for (Transform& slot : slots) {
+            if (slot.Determinant() == 0) slot = Transform{};
+        }
+    }
+
+    const uint64_t generation = list.Seal();
+    if (generation == m_preparedGeneration && slotVersion == m_preparedSlotVersion) return *m_preparedFrame;
+
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_frameStats.listBytes = list.ByteSize();
+    }
+
+    list.ResolveTransforms(DeviceTransform(), m_resolvedList, resolveSlots ? slots : nullptr, latchSlots);
+    for (int slot = 0; slot < DisplayList::MaxTransformSlots; slot++) m_preparedSlots[slot] = latchSlots ? slots[slot] : Transform{};
+
+    FrameStats stats;
+    const uint32_t layers = m_resolvedList.Layers();
+    const uint32_t slotMask = m_resolvedList.Slots();
+    if (layers == 1 && slotMask == 0) {
+        m_preparedFrame = &RunPasses(m_resolvedList, stats);
+    } else {
+        // optimization passes work within a layer and a slot, so that primitives stay with their slot
+        m_layeredList.Clear(m_resolvedList.Origin());
+        for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+            if (!(layers & (1u << layer))) continue;
+            for (int slot = -1; slot < DisplayList::MaxTransformSlots; slot++) {
+                if (slot >= 0 && !(slotMask & (1u << slot))) continue;
+                m_resolvedList.ExtractLayer(layer, slot, m_layerList);
+                const DisplayList& prepared = RunPasses(m_layerList, stats);
+                if (prepared.Empty()) continue;
+                m_layeredList.AddLayer(layer);
+                m_layeredList.AddSlot(slot);
+                m_layeredList.Append(prepared);
+            }
+        }
+        m_layeredList.SetClipping(list.IsClipping());
+        m_preparedFrame = &m_layeredList;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        if (m_simplification) {
+            m_frameStats.primitivesBefore = stats.primitivesBefore;
+            m_frameStats.primitivesAfter = stats.primitivesAfter;
+        }
+        if (m_pathOptimization) {
+            m_frameStats.samplesSaved = stats.samplesSaved;
+            m_frameStats.blankTravel = stats.blankTravel;
+            m_frameStats.blankTravelSaved = stats.blankTravelSaved;
+            m_frameStats.optimizeMs = stats.optimizeMs;
+        }
+    }
+    m_preparedGeneration = generation;
+    m_preparedSlotVersion = slotVersion;
+    return *m_preparedFrame;
+}
+
+// Runs the enabled passes on a list with resolved transforms and adds their statistics to stats
+DisplayList& DrawDevice::RunPasses(DisplayList& list, FrameStats& stats)
+{
+    DisplayList* frame = &list;
+
+    if (list.IsClipping()) {
+        // viewport in output coordinates
+        const Transform device = DeviceTransform();
+        const Point topLeft = device.Apply({m_viewPort.left, m_viewPort.top});
+        const Point bottomRight = device.Apply({m_viewPort.right, m_viewPort.bottom});
+        ClipToRectangle(list, {topLeft.x, topLeft.y, bottomRight.x, bottomRight.y}, m_clippedList, &m_frameArena, &m_clipSampler);
+        frame = &m_clippedList;
+    }
+
+    if (m_simplification) {
+        // output range [-1, 1] has 65536 DAC steps
+        const float tolerance = m_simplificationTolerance / 32768.0f;
+        auto simplifierStats = m_simplifier.Simplify(*frame, m_simplifiedList, tolerance, &m_frameArena);
+        frame = &m_simplifiedList;
+
+        stats.primitivesBefore += simplifierStats.primitivesBefore;
+        stats.primitivesAfter += simplifierStats.primitivesAfter;
+    }
+
+    if (m_pathOptimization) {
+        DisplayList& source = *frame;
+        auto optimizerStats = m_pathOptimizer.Optimize(source, m_preparedList, m_pathOptimizationBudgetMs, &m_frameArena);
+        frame = &m_preparedList;
+
+        stats.samplesSaved += optimizerStats.samplesSaved;
+        stats.blankTravel += optimizerStats.travelAfter;
+        stats.blankTravelSaved += optimizerStats.travelBefore - optimizerStats.travelAfter;
+        stats.optimizeMs += optimizerStats.elapsedMs;
+    }
+    return *frame;
+}
+
+void DrawDevice::SetFrameSampleCount(const size_t* layerSamples, float sampleRate, float detail)
+{
+    // Layers with a refresh divisor add only a part of their samples to an average refresh
+    float refreshSamples = 0;
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) refreshSamples += float(layerSamples[layer]) / LayerRefreshDivisor(layer);
+    const float refreshRate = sampleRate > 0 && refreshSamples > 0 ? sampleRate / refreshSamples : 0;
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_frameStats.samples = size_t(refreshSamples + 0.5f);
+    m_frameStats.refreshRate = refreshRate;
+    m_frameStats.detail = detail;
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+        m_frameStats.layerSamples[layer] = layerSamples[layer];
+        m_frameStats.layerRefreshRate[layer] = layerSamples[layer] ? refreshRate / LayerRefreshDivisor(layer) : 0;
+    }
+    if (!m_pathOptimization) {
+        m_frameStats.samplesSaved = 0;
+        m_frameStats.blankTravel = 0;
+        m_frameStats.blankTravelSaved = 0;
+        m_frameStats.optimizeMs = 0;
+    }
+    if (!m_simplification) {
+        m_frameStats.primitivesBefore = 0;
+        m_frameStats.primitivesAfter = 0;
+    }
+}
+
+void DrawDevice::ResetFrameArena()
+{
+    m_frameArena.Reset();
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_frameStats.scratchBytes = m_frameArena.HighWater();
+    m_frameStats.scratchAllocations = m_frameArena.HeapAllocations();
+}
 
-void DrawDevice::SetPoint(Point p)
+FrameStats DrawDevice::GetFrameStats()
 {
-    m_currPoint = p;
-    GraphicsPrimitive op{GraphicsPrimitive::Type::DRAW_SYNC, -1, m_currIntensity,  m_currPoint, m_currPoint};
-    m_operations.emplace_back(op);
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_frameStats;
 }
 
 }  // namespace AudioRender
@@ -0,0 +1,76 @@
+#include "pch.h"
+
+#include <assert.h>
+
+#include "FrameArena.hpp"
+
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+
+namespace AudioRender
+{
+static inline size_t alignUp(size_t offset, size_t alignment) { return (offset + alignment - 1) & ~(alignment - 1); }
+
+FrameArena::FrameArena(size_t initialSize)
+{
+    m_capacity = initialSize;
+    m_block = AllocateBlock(m_capacity);
+}
+
+FrameArena::~FrameArena()
+{
+    Reset();
+    ::operator delete(m_block);
+}
+
+uint8_t* FrameArena::AllocateBlock(size_t size)
+{
+    m_heapAllocations++;
+    return static_cast<uint8_t*>(::operator new(size));
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    // blocks from operator new are aligned for any fundamental type
+    assert(alignment <= alignof(std::max_align_t) && (alignment & (alignment - 1)) == 0);
+
+    if (m_overflow.empty()) {
+        const size_t offset = alignUp(m_offset, alignment);
+        if (offset + size <= m_capacity) {
+            m_used += offset + size - m_offset;
+            m_offset = offset + size;
+            return m_block + offset;
+        }
+    } else {
+        const size_t offset = alignUp(m_overflowOffset, alignment);
+        if (offset + size <= m_overflowSize) {
+            m_used += offset + size - m_overflowOffset;
+            m_overflowOffset = offset + size;
+            return m_overflow.back() + offset;
+        }
+    }
+
+    // Frame did not fit, continue in a new block. Reset replaces the blocks with one that fits the frame.
+    m_overflowSize = MAX(size, m_capacity);
+    m_overflow.push_back(AllocateBlock(m_overflowSize));
+    m_overflowOffset = size;
+    m_used += size;
+    return m_overflow.back();
+}
+
+void FrameArena::Reset()
+{
+    m_highWater = MAX(m_highWater, m_used);
+    if (!m_overflow.empty()) {
+        for (uint8_t* block : m_overflow) ::operator delete(block);
+        m_overflow.clear();
+        ::operator delete(m_block);
+        // some headroom so that a slightly larger frame does not overflow again
+        m_capacity = alignUp(m_highWater + m_highWater / 4, 4096);
+        m_block = AllocateBlock(m_capacity);
+    }
+    m_offset = 0;
+    m_overflowOffset = 0;
+    m_overflowSize = 0;
+    m_used = 0;
+}
+}  // namespace AudioRender
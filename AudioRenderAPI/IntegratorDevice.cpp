@@ -38,6 +38,7 @@ void IntegratorGraphicsBuilder::setScale(float xscale, float yscale)
 {
     m_xScale = xscale * INTEG_SCALE_FACTOR;
     m_yScale = yscale * INTEG_SCALE_FACTOR;
+    m_preparedGeneration = 0;
 }
 
 static float norm(float x0, float y0, float x1, float y1)
@@ -140,24 +141,36 @@ bool pathSample(FTSample& sample, float xref, float yref, float x0, float y0, fl
     return true;
 }
 
-void IntegratorGraphicsBuilder::EncodeSamples(const std::vector<GraphicsPrimitive>& ops)
+void IntegratorGraphicsBuilder::EncodeSamples(const DisplayList& list)
 {
     int points = 0;
-    EncodeCtx ctx{0};
 
     m_samples.clear();
 
-    for (size_t i = 0; i < ops.size(); i++) {
-        const GraphicsPrimitive& p = ops[i];
-        switch (p.type) {
-            case GraphicsPrimitive::Type::DRAW_CIRCLE: points += EncodeCircle(p, ctx); break;
-            case GraphicsPrimitive::Type::DRAW_LINE: points += EncodeLine(p, ctx); break;
-            case GraphicsPrimitive::Type::DRAW_SYNC: points += EncodeSync(p, ctx); break;
-            default:
-                // Unknown
-                break;
+    // Layers are encoded one after another, so that each can be sent on its own
+    const uint32_t layers = list.Layers();
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+        m_layerOffsets[layer] = m_samples.size();
+        if (!(layers & (1u << layer))) continue;
+
+        EncodeCtx ctx{0};
+        DisplayList::Reader reader(list, &m_frameArena);
+        GraphicsPrimitive p;
+        while (reader.Next(p)) {
+            if (reader.Layer() != layer) continue;
+            switch (p.type) {
+                case GraphicsPrimitive::Type::DRAW_CIRCLE: points += EncodeCircle(p, ctx); break;
+                case GraphicsPrimitive::Type::DRAW_LINE: points += EncodeLine(p, ctx); break;
+                case GraphicsPrimitive::Type::DRAW_CURVE: points += EncodeCurve(p, ctx); break;
+                case GraphicsPrimitive::Type::DRAW_PARAMETRIC: points += EncodeParametric(p, ctx); break;
+                case GraphicsPrimitive::Type::DRAW_SYNC: points += EncodeSync(p, ctx); break;
+                default:
+                    // Unknown
+                    break;
+            }
         }
     }
+    m_layerOffsets[DisplayList::MaxLayers] = m_samples.size();
 }
 
 int IntegratorGraphicsBuilder::encodeSync(float x, float y, EncodeCtx& ctx)
@@ -183,15 +196,15 @@ int IntegratorGraphicsBuilder::encodeSync(float x, float y, EncodeCtx& ctx)
 
     if (x != 0 || y != 0) {
         // move the beam as fast as possible to the desired starting location
-        if (fastPathSample(sample, ctx.xref, ctx.yref, ctx.xref, ctx.yref, m_xScale * x, m_yScale * y)) {
+        if (fastPathSample(sample, ctx.xref, ctx.yref, ctx.xref, ctx.yref, x, y)) {
             m_samples.emplace_back(sample);
             samplec++;
         }
     }
 #else
 
-    ctx.xref = x * m_xScale;
-    ctx.yref = y * m_yScale;
+    ctx.xref = x;
+    ctx.yref = y;
     ctx.syncPoint = true;
 
     // Reset the integrator to a specified levels
@@ -216,7 +229,7 @@ int IntegratorGraphicsBuilder::EncodeLine(const GraphicsPrimitive& p, EncodeCtx&
 {
     FTSample sample;    
     
-    if (pathSample(sample, ctx.xref, ctx.yref, m_xScale * p.p.x, m_yScale * p.p.y, m_xScale * p.toPoint.x, m_yScale * p.toPoint.y, p.intensity)) {
+    if (pathSample(sample, ctx.xref, ctx.yref, p.p.x, p.p.y, p.toPoint.x, p.toPoint.y, p.intensity)) {
         ctx.syncPoint = false;
         m_samples.emplace_back(sample);
         return 1;
@@ -224,23 +237,64 @@ int IntegratorGraphicsBuilder::EncodeLine(const GraphicsPrimitive& p, EncodeCtx&
     return 0;
 }
 
+int IntegratorGraphicsBuilder::EncodeCurve(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    const float CurveTolerance = 0.002f;  // largest distance of the path segments from the curve
+    const int segments = p.CurveSegments(CurveTolerance);
+
+    int samplec = 0;
+    Point prev = p.p;
+    for (int i = 1; i <= segments; i++) {
+        const Point next = p.CurvePoint(float(i) / segments);
+        FTSample sample;
+        if (pathSample(sample, ctx.xref, ctx.yref, prev.x, prev.y, next.x, next.y, p.intensity)) {
+            ctx.syncPoint = false;
+            m_samples.emplace_back(sample);
+            samplec++;
+        }
+        prev = next;
+    }
+    return samplec;
+}
+
+int IntegratorGraphicsBuilder::EncodeParametric(const GraphicsPrimitive& p, EncodeCtx& ctx)
+{
+    const float CurveTolerance = 0.002f;  // largest distance of the path segments from the curve
+    const size_t count = m_parametricSampler.Flatten(p, CurveTolerance);
+    const Point* points = m_parametricSampler.Points();
+
+    // Path segments follow the curve, their timing sets the beam speed
+    int samplec = encodeSync(points[0].x, points[0].y, ctx);
+    for (size_t i = 1; i < count; i++) {
+        FTSample sample;
+        if (pathSample(sample, ctx.xref, ctx.yref, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y, p.intensity)) {
+            ctx.syncPoint = false;
+            m_samples.emplace_back(sample);
+            samplec++;
+        }
+    }
+    return samplec;
+}
+
 int IntegratorGraphicsBuilder::EncodeCircle(const GraphicsPrimitive& p, EncodeCtx& ctx)
 {
     const float CircleSegmentMultiplier = 100.0f;  // how many segments in unit circle
-    const float Pi = 3.14159f;
-    const int stepCount = (int)ceil(CircleSegmentMultiplier * p.r * p.intensity);
-    const float angleStep = Pi * 2 / stepCount;
+    const float arc = (p.arcEnd - p.arcStart) / DisplayList::FullCircle;
+    const int stepCount = MAX(1, (int)ceil(CircleSegmentMultiplier * p.r * p.intensity * arc));
+    const float angleStep = (p.arcEnd - p.arcStart) / stepCount;
 
     Point prev;
     for (int i = 0; i < stepCount + 1; i++) {
-        float x = p.r * sinf(i * angleStep) + p.p.x;
-        float y = p.r * cosf(i * angleStep) + p.p.y;
+        const float s = sinf(p.arcStart + i * angleStep);
+        const float c = cosf(p.arcStart + i * angleStep);
+        float x = p.p.x + s * p.axisX.x + c * p.axisY.x;
+        float y = p.p.y + s * p.axisX.y + c * p.axisY.y;
 
         if (i == 0) {
             encodeSync(x, y, ctx);
         } else {
             FTSample sample;
-            pathSample(sample, ctx.xref, ctx.yref, m_xScale * prev.x, m_yScale * prev.y, m_xScale * x, m_yScale * y, p.intensity);
+            pathSample(sample, ctx.xref, ctx.yref, prev.x, prev.y, x, y, p.intensity);
             m_samples.emplace_back(sample);
         }
         prev.x = x;
@@ -334,14 +388,31 @@ void IntegratorDevice::SetFrameDuration(int ms)
 
 void IntegratorDevice::Submit()
 {
-    // build samples
-    EncodeSamples(m_operations);
+    // build samples, unless the same display list was already encoded
+    ResetFrameArena();
+    DisplayList& frame = PrepareFrame(m_recorder.List());
+    const uint64_t generation = frame.Seal();
+    if (generation != m_samplesGeneration) {
+        EncodeSamples(frame);
+        m_samplesGeneration = generation;
+
+        size_t layerSamples[DisplayList::MaxLayers];
+        for (int layer = 0; layer < DisplayList::MaxLayers; layer++) layerSamples[layer] = m_layerOffsets[layer + 1] - m_layerOffsets[layer];
+        SetFrameSampleCount(layerSamples);
+    }
+
+    // Layers that are not due on this refresh are left out of the frame
+    const uint32_t refresh = m_refreshCount++;
+    m_frameSamples.clear();
+    for (int layer = 0; layer < DisplayList::MaxLayers; layer++) {
+        if (!LayerDue(layer, refresh)) continue;
+        m_frameSamples.insert(m_frameSamples.end(), m_samples.begin() + m_layerOffsets[layer], m_samples.begin() + m_layerOffsets[layer + 1]);
+    }
 
     // submit data
-    if (m_samples.size() == 0) return;
+    if (m_frameSamples.size() == 0) return;
 
-    std::vector<byte> buffer(FT_MAX_PACKET_SIZE);
-    FTPacket* packet = (FTPacket*)buffer.data();
+    FTPacket* packet = (FTPacket*)m_frameArena.Allocate(FT_MAX_PACKET_SIZE);
     int packetc = 0;
     bool done = false;
     size_t si = 0;
@@ -354,15 +425,15 @@ void IntegratorDevice::Submit()
 
         // fill a packet with samples
         int samplec = 0;
-        for (; samplec < FT_MAX_PACKET_SAMPLES && si < m_samples.size(); si++, samplec++) {
-            packet->frame.samples[samplec] = m_samples[si];
+        for (; samplec < FT_MAX_PACKET_SAMPLES && si < m_frameSamples.size(); si++, samplec++) {
+            packet->frame.samples[samplec] = m_frameSamples[si];
         }
         setFramePacketSize(packet, samplec);
 
         if (packetc == 1) {
             packet->frame.sof = 1;  // first packet, start of frame
         }
-        if (si == m_samples.size() || packetc == MAX_PACKETS_PER_FRAME) {
+        if (si == m_frameSamples.size() || packetc == MAX_PACKETS_PER_FRAME) {
             packet->frame.eof = 1;  // last packet, end of frame
             done = true;
         }
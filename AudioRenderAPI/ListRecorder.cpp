@@ -0,0 +1,128 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "ListRecorder.hpp"
+
+namespace AudioRender
+{
+void ListRecorder::Reset()
+{
+    m_list.Clear(Point{0});
+    m_currIntensity = DefaultIntensity;
+    m_transform = Transform{};
+    m_transformStack.clear();
+    m_transformChanged = false;
+}
+
+void ListRecorder::SetPoint(Point p)
+{
+    FlushTransform();
+    m_list.AddSync(p);
+}
+
+void ListRecorder::DrawCircle(float radius)
+{
+    FlushTransform();
+    m_list.AddCircle(radius, m_currIntensity);
+}
+
+void ListRecorder::DrawLine(Point to, float intensity)
+{
+    FlushTransform();
+    float fromIntensity = m_currIntensity;
+    if (intensity >= 0) m_currIntensity = intensity;
+    m_list.AddLine(to, fromIntensity, m_currIntensity);
+}
+
+void ListRecorder::DrawQuadratic(Point control, Point to)
+{
+    FlushTransform();
+    m_list.AddQuadratic(control, to, m_currIntensity);
+}
+
+void ListRecorder::DrawCubic(Point control1, Point control2, Point to)
+{
+    FlushTransform();
+    m_list.AddCubic(control1, control2, to, m_currIntensity);
+}
+
+void ListRecorder::DrawArc(Point center, float radius, float startAngle, float endAngle)
+{
+    FlushTransform();
+    if (endAngle < startAngle) std::swap(startAngle, endAngle);
+    // a full circle would be centered on the current point, so the arc stops just short of it
+    endAngle = std::min(endAngle, startAngle + DisplayList::FullCircle * 0.9999f);
+    // arc point at t is center + sin(t) * axisX + cos(t) * axisY
+    m_list.AddArc(center, radius, m_currIntensity, {0, radius}, {radius, 0}, startAngle, endAngle);
+}
+
+void ListRecorder::DrawPolyline(const Point* points, size_t count, bool closed)
+{
+    if (count == 0) return;
+
+    FlushTransform();
+    m_list.AddSync(points[0]);
+    m_list.AddPolyline(points + 1, count - 1, m_currIntensity);
+    if (closed && count > 1) m_list.AddLine(points[0], m_currIntensity);
+}
+
+void ListRecorder::DrawPaths(const Point* points, const size_t* counts, size_t pathCount, bool closed)
+{
+    for (size_t i = 0; i < pathCount; i++) {
+        DrawPolyline(points, counts[i], closed);
+        points += counts[i];
+    }
+}
+
+void ListRecorder::DrawParametric(std::shared_ptr<const ParametricCurve> curve, float t0, float t1)
+{
+    if (!curve) return;
+
+    FlushTransform();
+    m_list.AddParametric(std::move(curve), t0, t1, m_currIntensity);
+}
+
+void ListRecorder::DrawInstance(std::shared_ptr<const DisplayList> shape, const Transform& t, float intensity)
+{
+    if (!shape) return;
+
+    FlushTransform();
+    m_list.AddInstance(std::move(shape), t, intensity);
+}
+
+void ListRecorder::SetTransform(const Transform& t)
+{
+    m_transform = t;
+    m_transformChanged = true;
+}
+
+void ListRecorder::PushTransform(const Transform& t)
+{
+    m_transformStack.push_back(m_transform);
+    SetTransform(m_transform * t);
+}
+
+void ListRecorder::PopTransform()
+{
+    if (m_transformStack.empty()) return;
+    SetTransform(m_transformStack.back());
+    m_transformStack.pop_back();
+}
+
+void ListRecorder::SetTransformSlot(int slot)
+{
+    // slot transform is applied to the stored vertices later, like a transform
+    if (slot >= 0) m_list.Dequantize();
+    m_list.AddSlot(slot);
+}
+
+void ListRecorder::FlushTransform()
+{
+    if (!m_transformChanged) return;
+    // Drawing in user units would be clamped to the quantized range before the transform is applied
+    if (!m_transform.IsIdentity()) m_list.Dequantize();
+    m_list.AddTransform(m_transform);
+    m_transformChanged = false;
+}
+}  // namespace AudioRender
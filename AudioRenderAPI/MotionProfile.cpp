@@ -0,0 +1,95 @@
+#include "pch.h"
+
+#include <cmath>
+
+#include "MotionProfile.hpp"
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define CLAMP(x, minx, maxx) MAX(minx, MIN(maxx, x))
+
+namespace AudioRender
+{
+const float Pi = 3.14159265f;
+// Speed change per sample, in distance per sample. Cruise speed of a full intensity line at detail 1 is 1 / 18.
+const float MaxAcceleration = 0.02f;
+// Samples on the corner point where the line turns back, fewer on smaller turns
+const float CornerDwell = 3.0f;
+
+// Cosine of the turn from in to out, false if out does not continue from the end of in
+static bool turnCosine(const MotionProfile::Line& in, const MotionProfile::Line& out, Point scale, float& cosine)
+{
+    if (in.to.x != out.from.x || in.to.y != out.from.y) return false;
+    const float ix = (in.to.x - in.from.x) / scale.x;
+    const float iy = (in.to.y - in.from.y) / scale.y;
+    const float ox = (out.to.x - out.from.x) / scale.x;
+    const float oy = (out.to.y - out.from.y) / scale.y;
+    const float lengths = sqrtf((ix * ix + iy * iy) * (ox * ox + oy * oy));
+    // Zero length lines have no direction, the beam stops on them
+    if (lengths <= 0) return false;
+    cosine = CLAMP((ix * ox + iy * oy) / lengths, -1.0f, 1.0f);
+    return true;
+}
+
+size_t MotionProfile::Add(State& state, const Line& line, int slot, Point scale)
+{
+    size_t count = 0;
+    if (state.pending) {
+        count = Plan(state, &line, scale);
+    } else {
+        state.entrySpeed = 0;
+    }
+    state.pending = true;
+    state.line = line;
+    state.slot = slot;
+    return count;
+}
+
+size_t MotionProfile::Finish(State& state, Point scale)
+{
+    if (!state.pending) return 0;
+    return Plan(state, nullptr, scale);
+}
+
+size_t MotionProfile::Plan(State& state, const Line* next, Point scale)
+{
+    const Line& line = state.line;
+    m_points.clear();
+    state.pending = false;
+
+    // Corner speed falls to zero at right angles, dwell grows with the turn
+    float exitSpeed = 0;
+    int dwell = 0;
+    float cosine;
+    if (next && turnCosine(line, *next, scale, cosine)) {
+        exitSpeed = MIN(line.toSpeed, next->fromSpeed) * MAX(0.0f, cosine);
+        dwell = lround(CornerDwell * acosf(cosine) / Pi);
+    }
+
+    const float vx = line.to.x - line.from.x;
+    const float vy = line.to.y - line.from.y;
+    const float dx = vx / scale.x;
+    const float dy = vy / scale.y;
+    const float length = sqrtf(dx * dx + dy * dy);
+
+    // Speed is limited by the cruise speed at the current point, by the acceleration from the previous step and by
+    // the distance needed to slow down to the exit speed. Braking limit is at least the remaining distance when it
+    // is shorter than two steps of acceleration, so the end is always reached.
+    float x = 0;
+    float v = state.entrySpeed;
+    while (x < length) {
+        const float cruise = line.fromSpeed + (line.toSpeed - line.fromSpeed) * (x / length);
+        const float brake = sqrtf(exitSpeed * exitSpeed + 2 * MaxAcceleration * (length - x));
+        v = MIN(MIN(cruise, v + MaxAcceleration), brake);
+        x += v;
+        if (x >= length) break;
+        const float t = x / length;
+        m_points.push_back({line.from.x + t * vx, line.from.y + t * vy});
+    }
+    m_points.push_back(line.to);
+    for (int i = 0; i < dwell; i++) m_points.push_back(line.to);
+
+    state.entrySpeed = MIN(v, exitSpeed);
+    return m_points.size();
+}
+}  // namespace AudioRender
@@ -0,0 +1,333 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parametric.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PARAMETRIC_SSE2
+#endif
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define CLAMP(x, minx, maxx) MAX(minx, MIN(maxx, x))
+
+namespace AudioRender
+{
+const float Pi = 3.14159265f;
+// Limits of the adaptive refinement
+const int MaxSegments = 1 << 16;
+const int MaxDepth = 10;
+// Samples are not placed closer than spacing / MaxStepDivisor however tightly the curve turns
+const float MaxStepDivisor = 8.0f;
+
+#ifdef PARAMETRIC_SSE2
+// Sine and cosine of four values. Values are reduced to [-pi/4, pi/4] by quadrant and the polynomials are the ones of
+// the Cephes library, error is within a few ulps for arguments of moderate size.
+static inline void sinCos4(__m128 x, __m128& s, __m128& c)
+{
+    const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977f)));  // rounds to nearest
+    const __m128 j = _mm_cvtepi32_ps(q);
+    // pi / 2 in three parts, so that j * part is exact
+    __m128 y = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(1.5703125f)));
+    y = _mm_sub_ps(y, _mm_mul_ps(j, _mm_set1_ps(4.837512969970703125e-4f)));
+    y = _mm_sub_ps(y, _mm_mul_ps(j, _mm_set1_ps(7.54978995489188216e-8f)));
+    const __m128 z = _mm_mul_ps(y, y);
+
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), y), y);
+    __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+    pc = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(pc, z), z), _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // odd quadrants swap sine and cosine, sine is negative in quadrants 2 and 3 and cosine in 1 and 2
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+    s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps)), sinSign);
+    c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc)), cosSign);
+}
+
+// Stores four x and four y coordinates as points
+static inline void storePoints(Point* points, __m128 x, __m128 y)
+{
+    float* data = reinterpret_cast<float*>(points);
+    _mm_storeu_ps(data, _mm_unpacklo_ps(x, y));
+    _mm_storeu_ps(data + 4, _mm_unpackhi_ps(x, y));
+}
+#endif
+
+// Even intervals for periods of the highest frequency
+static int periodSegments(float t0, float t1, float frequency, float segmentsPerPeriod)
+{
+    const float periods = fabsf(t1 - t0) * frequency / (2 * Pi);
+    return int(CLAMP(ceilf(periods * segmentsPerPeriod), 16.0f, float(MaxSegments)));
+}
+
+namespace
+{
+class SinusoidCurve : public ParametricCurve
+{
+public:
+    SinusoidCurve(const Sinusoid* x, size_t xCount, const Sinusoid* y, size_t yCount)
+        : m_x(x, x + xCount)
+        , m_y(y, y + yCount)
+    {
+        for (const Sinusoid& s : m_x) m_maxFrequency = MAX(m_maxFrequency, fabsf(s.frequency));
+        for (const Sinusoid& s : m_y) m_maxFrequency = MAX(m_maxFrequency, fabsf(s.frequency));
+    }
+
+    void Evaluate(const float* t, Point* points, size_t count) const override
+    {
+        size_t i = 0;
+#ifdef PARAMETRIC_SSE2
+        for (; i + 4 <= count; i += 4) {
+            const __m128 tv = _mm_loadu_ps(t + i);
+            __m128 x = _mm_setzero_ps();
+            __m128 y = _mm_setzero_ps();
+            __m128 s, c;
+            for (const Sinusoid& term : m_x) {
+                sinCos4(_mm_add_ps(_mm_mul_ps(tv, _mm_set1_ps(term.frequency)), _mm_set1_ps(term.phase)), s, c);
+                x = _mm_add_ps(x, _mm_mul_ps(s, _mm_set1_ps(term.amplitude)));
+            }
+            for (const Sinusoid& term : m_y) {
+                sinCos4(_mm_add_ps(_mm_mul_ps(tv, _mm_set1_ps(term.frequency)), _mm_set1_ps(term.phase)), s, c);
+                y = _mm_add_ps(y, _mm_mul_ps(s, _mm_set1_ps(term.amplitude)));
+            }
+            storePoints(points + i, x, y);
+        }
+#endif
+        for (; i < count; i++) {
+            Point p;
+            for (const Sinusoid& term : m_x) p.x += term.amplitude * sinf(term.frequency * t[i] + term.phase);
+            for (const Sinusoid& term : m_y) p.y += term.amplitude * sinf(term.frequency * t[i] + term.phase);
+            points[i] = p;
+        }
+    }
+
+    int Segments(float t0, float t1) const override { return periodSegments(t0, t1, m_maxFrequency, 16); }
+
+private:
+    std::vector<Sinusoid> m_x;
+    std::vector<Sinusoid> m_y;
+    float m_maxFrequency = 0;
+};
+
+class PolarCurve : public ParametricCurve
+{
+public:
+    PolarCurve(float r0, float growth, const Sinusoid* terms, size_t count)
+        : m_r0(r0)
+        , m_growth(growth)
+        , m_terms(terms, terms + count)
+    {
+        for (const Sinusoid& s : m_terms) m_maxFrequency = MAX(m_maxFrequency, fabsf(s.frequency));
+    }
+
+    void Evaluate(const float* t, Point* points, size_t count) const override
+    {
+        size_t i = 0;
+#ifdef PARAMETRIC_SSE2
+        for (; i + 4 <= count; i += 4) {
+            const __m128 tv = _mm_loadu_ps(t + i);
+            __m128 r = _mm_add_ps(_mm_set1_ps(m_r0), _mm_mul_ps(tv, _mm_set1_ps(m_growth)));
+            __m128 s, c;
+            for (const Sinusoid& term : m_terms) {
+                sinCos4(_mm_add_ps(_mm_mul_ps(tv, _mm_set1_ps(term.frequency)), _mm_set1_ps(term.phase)), s, c);
+                r = _mm_add_ps(r, _mm_mul_ps(s, _mm_set1_ps(term.amplitude)));
+            }
+            sinCos4(tv, s, c);
+            storePoints(points + i, _mm_mul_ps(r, c), _mm_mul_ps(r, s));
+        }
+#endif
+        for (; i < count; i++) {
+            float r = m_r0 + m_growth * t[i];
+            for (const Sinusoid& term : m_terms) r += term.amplitude * sinf(term.frequency * t[i] + term.phase);
+            points[i] = {r * cosf(t[i]), r * sinf(t[i])};
+        }
+    }
+
+    int Segments(float t0, float t1) const override { return periodSegments(t0, t1, MAX(1.0f, m_maxFrequency), 32); }
+
+private:
+    float m_r0;
+    float m_growth;
+    std::vector<Sinusoid> m_terms;
+    float m_maxFrequency = 0;
+};
+
+class FunctionCurve : public ParametricCurve
+{
+public:
+    FunctionCurve(std::function<Point(float)> f, int segments)
+        : m_f(std::move(f))
+        , m_segments(segments)
+    {
+    }
+
+    void Evaluate(const float* t, Point* points, size_t count) const override
+    {
+        for (size_t i = 0; i < count; i++) points[i] = m_f(t[i]);
+    }
+
+    int Segments(float t0, float t1) const override { return m_segments; }
+
+private:
+    std::function<Point(float)> m_f;
+    int m_segments;
+};
+}  // namespace
+
+std::shared_ptr<const ParametricCurve> ParametricCurve::Sinusoids(const Sinusoid* x, size_t xCount, const Sinusoid* y, size_t yCount)
+{
+    return std::make_shared<SinusoidCurve>(x, xCount, y, yCount);
+}
+
+std::shared_ptr<const ParametricCurve> ParametricCurve::Lissajous(float ax, float fx, float ay, float fy, float phase)
+{
+    const Sinusoid x{ax, fx, phase};
+    const Sinusoid y{ay, fy, 0};
+    return std::make_shared<SinusoidCurve>(&x, 1, &y, 1);
+}
+
+std::shared_ptr<const ParametricCurve> ParametricCurve::Polar(float r0, float growth, const Sinusoid* terms, size_t count)
+{
+    return std::make_shared<PolarCurve>(r0, growth, terms, count);
+}
+
+std::shared_ptr<const ParametricCurve> ParametricCurve::Function(std::function<Point(float)> f, int segments)
+{
+    return std::make_shared<FunctionCurve>(std::move(f), segments);
+}
+
+// Distance of point p from segment a-b, with the coordinates divided by scale
+static float segmentDistance(Point p, Point a, Point b, Point scale)
+{
+    const float abx = (b.x - a.x) / scale.x;
+    const float aby = (b.y - a.y) / scale.y;
+    const float apx = (p.x - a.x) / scale.x;
+    const float apy = (p.y - a.y) / scale.y;
+    const float len2 = abx * abx + aby * aby;
+    const float t = len2 > 0 ? CLAMP((apx * abx + apy * aby) / len2, 0.0f, 1.0f) : 0.0f;
+    const float dx = apx - t * abx;
+    const float dy = apy - t * aby;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+void ParametricSampler::EvaluateTransformed(const DisplayList::Primitive& p, const float* t, Point* points, size_t count) const
+{
+    p.curve->Evaluate(t, points, count);
+    if (p.curveTransform.IsIdentity()) return;
+    for (size_t i = 0; i < count; i++) points[i] = p.curveTransform.Apply(points[i]);
+}
+
+void ParametricSampler::Refine(const DisplayList::Primitive& p, float tolerance, Point scale)
+{
+    const float t0 = p.arcStart;
+    const float t1 = p.arcEnd;
+    const int n = CLAMP(p.curve->Segments(t0, t1), 1, MaxSegments);
+    m_t.resize(n + 1);
+    for (int i = 0; i < n; i++) m_t[i] = t0 + (t1 - t0) * i / n;
+    m_t[n] = t1;
+    m_line.resize(n + 1);
+    EvaluateTransformed(p, m_t.data(), m_line.data(), n + 1);
+    m_open.assign(n, 1);
+
+    // Each round evaluates the middle points of the open intervals in one batch and splits the ones that bend
+    for (int depth = 0; depth < MaxDepth; depth++) {
+        m_splitT.clear();
+        for (size_t i = 0; i < m_open.size(); i++) {
+            if (m_open[i]) m_splitT.push_back(0.5f * (m_t[i] + m_t[i + 1]));
+        }
+        if (m_splitT.empty()) break;
+        m_split.resize(m_splitT.size());
+        EvaluateTransformed(p, m_splitT.data(), m_split.data(), m_splitT.size());
+
+        m_nextT.clear();
+        m_nextLine.clear();
+        m_nextOpen.clear();
+        size_t k = 0;
+        for (size_t i = 0; i < m_open.size(); i++) {
+            m_nextT.push_back(m_t[i]);
+            m_nextLine.push_back(m_line[i]);
+            if (m_open[i]) {
+                const Point mid = m_split[k];
+                const float tm = m_splitT[k++];
+                if (segmentDistance(mid, m_line[i], m_line[i + 1], scale) > tolerance) {
+                    m_nextOpen.push_back(1);
+                    m_nextT.push_back(tm);
+                    m_nextLine.push_back(mid);
+                    m_nextOpen.push_back(1);
+                    continue;
+                }
+            }
+            m_nextOpen.push_back(0);
+        }
+        m_nextT.push_back(m_t.back());
+        m_nextLine.push_back(m_line.back());
+        m_t.swap(m_nextT);
+        m_line.swap(m_nextLine);
+        m_open.swap(m_nextOpen);
+    }
+}
+
+size_t ParametricSampler::Flatten(const DisplayList::Primitive& p, float tolerance)
+{
+    Refine(p, tolerance, Point{1, 1});
+    m_points.assign(m_line.begin(), m_line.end());
+    return m_points.size();
+}
+
+size_t ParametricSampler::Sample(const DisplayList::Primitive& p, float spacing, float tolerance, Point scale)
+{
+    Refine(p, tolerance, scale);
+    const size_t intervals = m_line.size() - 1;
+
+    // Beam path between samples cuts a turn of curvature k by step^2 * k / 8, which limits the step where the line
+    // turns. Intervals are measured in steps.
+    m_steps.resize(intervals);
+    float prevLimit = spacing;
+    float total = 0;
+    for (size_t i = 0; i < intervals; i++) {
+        const float dx = (m_line[i + 1].x - m_line[i].x) / scale.x;
+        const float dy = (m_line[i + 1].y - m_line[i].y) / scale.y;
+        const float len = sqrtf(dx * dx + dy * dy);
+        float limit = spacing;
+        if (i + 1 < intervals) {
+            const float nx = (m_line[i + 2].x - m_line[i + 1].x) / scale.x;
+            const float ny = (m_line[i + 2].y - m_line[i + 1].y) / scale.y;
+            const float nextLen = sqrtf(nx * nx + ny * ny);
+            const float turn = atan2f(fabsf(dx * ny - dy * nx), dx * nx + dy * ny);
+            const float curvature = len + nextLen > 0 ? 2 * turn / (len + nextLen) : 0;
+            if (curvature > 0) limit = sqrtf(8 * tolerance / curvature);
+        }
+        const float step = CLAMP(MIN(prevLimit, limit), spacing / MaxStepDivisor, spacing);
+        prevLimit = limit;
+        m_steps[i] = len / step;
+        total += m_steps[i];
+    }
+
+    // Steps are stretched evenly so that the last sample lands on the end point
+    const size_t count = MAX(size_t(1), size_t(ceilf(total)));
+    const float stepsPerSample = total / count;
+    m_points.clear();
+    m_points.push_back(m_line[0]);
+    size_t interval = 0;
+    float intervalStart = 0;
+    for (size_t k = 1; k < count; k++) {
+        const float target = k * stepsPerSample;
+        while (interval + 1 < intervals && intervalStart + m_steps[interval] < target) intervalStart += m_steps[interval++];
+        const float f = m_steps[interval] > 0 ? MIN(1.0f, (target - intervalStart) / m_steps[interval]) : 0;
+        const Point a = m_line[interval];
+        const Point b = m_line[interval + 1];
+        m_points.push_back({a.x + f * (b.x - a.x), a.y + f * (b.y - a.y)});
+    }
+    m_points.push_back(m_line.back());
+    return m_points.size();
+}
+}  // namespace AudioRender
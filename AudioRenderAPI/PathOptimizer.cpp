@@ -0,0 +1,249 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <float.h>
+
+#include "PathOptimizer.hpp"
+
+namespace AudioRender
+{
+// Strokes closer than this are joined without a sync point
+const float JoinDistance = 1e-5f;
+
+static double nowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline float distance(Point p0, Point p1)
+{
+    const float dx = p1.x - p0.x;
+    const float dy = p1.y - p0.y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static inline float distanceSq(Point p0, Point p1)
+{
+    const float dx = p1.x - p0.x;
+    const float dy = p1.y - p0.y;
+    return dx * dx + dy * dy;
+}
+
+PathOptimizer::Stats PathOptimizer::Optimize(const DisplayList& list, DisplayList& out, float budgetMs, FrameArena* arena)
+{
+    const double start = nowMs();
+    const double deadline = start + budgetMs;
+    Stats stats;
+
+    const size_t syncSamplesBefore = SplitStrokes(list, arena);
+    stats.strokes = m_strokes.size();
+
+    // submission order
+    m_order.clear();
+    for (size_t i = 0; i < m_strokes.size(); i++) m_order.push_back({i, false});
+    stats.travelBefore = Travel();
+
+    NearestNeighbour(deadline);
+    TwoOpt(deadline);
+    stats.travelAfter = Travel();
+    if (stats.travelAfter > stats.travelBefore) {
+        // heuristics can lose to an already good submission order
+        for (size_t i = 0; i < m_strokes.size(); i++) m_order[i] = {i, false};
+        stats.travelAfter = stats.travelBefore;
+    }
+
+    if (out.IsQuantized() != list.IsQuantized()) out.SetQuantized(list.IsQuantized());
+    out.Clear(m_origin);
+    size_t syncSamplesAfter = 0;
+    stats.joined = Emit(out, syncSamplesAfter);
+    stats.samplesSaved = syncSamplesBefore > syncSamplesAfter ? syncSamplesBefore - syncSamplesAfter : 0;
+    stats.elapsedMs = float(nowMs() - start);
+    return stats;
+}
+
+size_t PathOptimizer::SplitStrokes(const DisplayList& list, FrameArena* arena)
+{
+    m_primitives.clear();
+    m_strokes.clear();
+    m_origin = list.Origin();
+
+    DisplayList::Reader reader(list, arena);
+    DisplayList::Primitive p;
+    while (reader.Next(p)) m_primitives.push_back(p);
+
+    // Sync point is a sample and the first line or curve after it adds a sample on its start point, like in the encoder
+    size_t syncSamples = 0;
+    bool syncPoint = false;
+
+    // Commands before the first sync point continue from the origin
+    Stroke stroke{0, 0, m_origin, m_origin, true, false, false};
+    for (size_t i = 0; i <= m_primitives.size(); i++) {
+        const bool sync = i == m_primitives.size() || m_primitives[i].type == DisplayList::Primitive::Type::DRAW_SYNC;
+        if (!sync) {
+            const DisplayList::Primitive& p = m_primitives[i];
+            if (p.type == DisplayList::Primitive::Type::DRAW_LINE || p.type == DisplayList::Primitive::Type::DRAW_CURVE) {
+                stroke.end = p.toPoint;
+                stroke.path = true;
+                if (syncPoint) syncSamples++;
+                syncPoint = false;
+            }
+            if (p.type == DisplayList::Primitive::Type::DRAW_CIRCLE && p.IsArc()) stroke.arc = true;
+            if (p.type == DisplayList::Primitive::Type::DRAW_PARAMETRIC) stroke.arc = true;
+            continue;
+        }
+        // sync points without any drawing are dropped
+        stroke.last = i;
+        if (stroke.last > stroke.first) m_strokes.push_back(stroke);
+        if (i < m_primitives.size()) {
+            stroke = {i + 1, i + 1, m_primitives[i].p, m_primitives[i].p, false, false, false};
+            syncSamples++;
+            syncPoint = true;
+        }
+    }
+    return syncSamples;
+}
+
+void PathOptimizer::NearestNeighbour(double deadline)
+{
+    const size_t count = m_strokes.size();
+    m_visited.assign(count, false);
+    m_order.clear();
+
+    Point curr = m_origin;
+    size_t next = 0;  // first unvisited stroke in submission order
+    while (m_order.size() < count) {
+        if ((m_order.size() & 63) == 0 && nowMs() > deadline) {
+            // out of time, keep rest in submission order
+            for (; next < count; next++) {
+                if (!m_visited[next]) m_order.push_back({next, false});
+            }
+            break;
+        }
+
+        Visit best{0, false};
+        float bestDist = FLT_MAX;
+        for (size_t i = next; i < count && bestDist > 0; i++) {
+            if (m_visited[i]) continue;
+            const float ds = distanceSq(curr, m_strokes[i].start);
+            if (ds < bestDist) {
+                bestDist = ds;
+                best = {i, false};
+            }
+            const float de = distanceSq(curr, m_strokes[i].end);
+            if (de < bestDist) {
+                bestDist = de;
+                best = {i, true};
+            }
+        }
+        m_visited[best.stroke] = true;
+        m_order.push_back(best);
+        curr = EndOf(best);
+        while (next < count && m_visited[next]) next++;
+    }
+}
+
+void PathOptimizer::TwoOpt(double deadline)
+{
+    // Reversing visits [i, j] replaces edges E(i-1) -> S(i) and E(j) -> S(j+1) with
+    // E(i-1) -> E(j) and S(i) -> S(j+1), as the reversed strokes swap their ends.
+    const size_t count = m_order.size();
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (size_t i = 0; i < count; i++) {
+            if (nowMs() > deadline) return;
+
+            const Point prevEnd = EndBefore(i);
+            const Point si = StartOf(m_order[i]);
+            const float edgeIn = distance(prevEnd, si);
+
+            for (size_t j = i; j < count; j++) {
+                const Point ej = EndOf(m_order[j]);
+                float before = edgeIn;
+                float after = distance(prevEnd, ej);
+                if (j + 1 < count) {
+                    const Point sn = StartOf(m_order[j + 1]);
+                    before += distance(ej, sn);
+                    after += distance(si, sn);
+                }
+                if (after < before - JoinDistance) {
+                    std::reverse(m_order.begin() + i, m_order.begin() + j + 1);
+                    for (size_t k = i; k <= j; k++) m_order[k].reversed = !m_order[k].reversed;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+float PathOptimizer::Travel() const
+{
+    float travel = 0;
+    for (size_t i = 0; i < m_order.size(); i++) travel += distance(EndBefore(i), StartOf(m_order[i]));
+    return travel;
+}
+
+size_t PathOptimizer::Emit(DisplayList& out, size_t& syncSamples) const
+{
+    using Type = DisplayList::Primitive::Type;
+    size_t joined = 0;
+    bool syncPoint = false;
+
+    for (size_t i = 0; i < m_order.size(); i++) {
+        const Visit& v = m_order[i];
+        const Stroke& stroke = m_strokes[v.stroke];
+        const Point start = StartOf(v);
+
+        // First stroke can skip the sync only if it was recorded that way
+        const bool needSync =
+            i == 0 ? !(stroke.leading && !v.reversed) : m_strokes[m_order[i - 1].stroke].arc || distance(EndBefore(i), start) > JoinDistance;
+        if (needSync) {
+            out.AddSync(start);
+            syncSamples++;
+            syncPoint = true;
+        } else if (i > 0) {
+            joined++;
+        }
+        if (stroke.path && syncPoint) {
+            syncSamples++;
+            syncPoint = false;
+        }
+
+        if (!v.reversed) {
+            for (size_t k = stroke.first; k < stroke.last; k++) {
+                const DisplayList::Primitive& p = m_primitives[k];
+                if (p.type == Type::DRAW_LINE) {
+                    out.AddLine(p.toPoint, p.intensity, p.toIntensity);
+                } else if (p.type == Type::DRAW_CURVE) {
+                    out.AddCubic(p.control1, p.control2, p.toPoint, p.intensity);
+                } else if (p.type == Type::DRAW_CIRCLE) {
+                    out.AddCircle(p);
+                } else if (p.type == Type::DRAW_PARAMETRIC) {
+                    out.AddParametric(p);
+                }
+            }
+        } else {
+            // Circles are centered on the current point, which is the same in both directions. Parametric curves
+            // have their own position and keep their direction.
+            for (size_t k = stroke.last; k-- > stroke.first;) {
+                const DisplayList::Primitive& p = m_primitives[k];
+                if (p.type == Type::DRAW_LINE) {
+                    out.AddLine(p.p, p.toIntensity, p.intensity);
+                } else if (p.type == Type::DRAW_CURVE) {
+                    out.AddCubic(p.control2, p.control1, p.p, p.intensity);
+                } else if (p.type == Type::DRAW_CIRCLE) {
+                    out.AddCircle(p);
+                } else if (p.type == Type::DRAW_PARAMETRIC) {
+                    out.AddParametric(p);
+                }
+            }
+        }
+    }
+    return joined;
+}
+
+}  // namespace AudioRender
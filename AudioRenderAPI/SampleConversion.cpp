@@ -0,0 +1,204 @@
+#include "pch.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "SampleConversion.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CONVERSION_SSE2
+#elif defined(_M_ARM64) || (defined(__aarch64__) && defined(__ARM_NEON))
+#include <arm_neon.h>
+#define CONVERSION_NEON
+#endif
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define CLAMP(x, minx, maxx) MAX(minx, MIN(maxx, x))
+
+namespace AudioRender
+{
+namespace SampleConversion
+{
+namespace
+{
+// Coordinate 1 is the largest positive 16-bit value. 24-bit values are taken from the top of a 32-bit one, the
+// largest float below 2^31 keeps the value in range.
+const float Pcm16Scale = 32767.0f;
+const float Pcm16Min = -32768.0f;
+const float Pcm16Max = 32767.0f;
+const float Pcm32Scale = 2147483648.0f;
+const float Pcm32Min = -2147483648.0f;
+const float Pcm32Max = 2147483520.0f;
+
+// NaN is clamped to the maximum
+inline int16_t ToInt16(float v)
+{
+    return int16_t(roundf(CLAMP(v * Pcm16Scale, Pcm16Min, Pcm16Max)));
+}
+
+inline int32_t ToInt24(float v)
+{
+    return int32_t(roundf(CLAMP(v * Pcm32Scale, Pcm32Min, Pcm32Max))) >> 8;
+}
+
+inline void Store24(uint8_t* out, int32_t v)
+{
+    out[0] = v & 0xFF;
+    out[1] = (v >> 8) & 0xFF;
+    out[2] = (v >> 16) & 0xFF;
+}
+
+#ifdef CONVERSION_SSE2
+// Scales and clamps like the scalar versions. Minimum returns its second operand for NaN.
+inline __m128 Scale(__m128 v, __m128 scale, __m128 min, __m128 max)
+{
+    return _mm_max_ps(_mm_min_ps(_mm_mul_ps(v, scale), max), min);
+}
+
+// Rounds half away from zero like roundf. Difference to the truncated value is exact within int32 range.
+inline __m128i Round(__m128 v)
+{
+    const __m128i i = _mm_cvttps_epi32(v);
+    const __m128 f = _mm_sub_ps(v, _mm_cvtepi32_ps(i));
+    const __m128i up = _mm_castps_si128(_mm_cmpge_ps(f, _mm_set1_ps(0.5f)));
+    const __m128i down = _mm_castps_si128(_mm_cmple_ps(f, _mm_set1_ps(-0.5f)));
+    return _mm_add_epi32(_mm_sub_epi32(i, up), down);
+}
+
+// Writes the low three bytes of the four values to 12 bytes
+inline void Store24(uint8_t* out, __m128i v)
+{
+    const __m128i low = _mm_and_si128(v, _mm_set1_epi32(0x00FFFFFF));
+    // pairs of values to six bytes in each half
+    const __m128i even = _mm_setr_epi32(-1, 0, -1, 0);
+    const __m128i pairs = _mm_or_si128(_mm_and_si128(low, even), _mm_srli_epi64(_mm_andnot_si128(even, low), 8));
+    const __m128i packed = _mm_or_si128(_mm_move_epi64(pairs), _mm_slli_si128(_mm_unpackhi_epi64(pairs, _mm_setzero_si128()), 6));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+    const int32_t rest = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+    memcpy(out + 8, &rest, 4);
+}
+#endif
+
+#ifdef CONVERSION_NEON
+// Minimum returns the number for NaN, conversion rounds half away from zero like roundf
+inline int32x4_t Round(float32x4_t v, float32x4_t scale, float32x4_t min, float32x4_t max)
+{
+    return vcvtaq_s32_f32(vmaxq_f32(vminnmq_f32(vmulq_f32(v, scale), max), min));
+}
+
+// Writes the low three bytes of the four values to 12 bytes
+inline void Store24(uint8_t* out, int32x4_t v)
+{
+    static const uint8_t index[16] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 255, 255, 255, 255};
+    const uint8x16_t packed = vqtbl1q_u8(vreinterpretq_u8_s32(v), vld1q_u8(index));
+    vst1_u8(out, vget_low_u8(packed));
+    vst1q_lane_u32(reinterpret_cast<uint32_t*>(out + 8), vreinterpretq_u32_u8(packed), 2);
+}
+#endif
+}  // namespace
+
+void ToPCM16Scalar(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    int16_t* samples = reinterpret_cast<int16_t*>(out);
+    for (size_t i = 0; i < count; i++) {
+        samples[i * 2] = ToInt16(x[i]);
+        samples[i * 2 + 1] = ToInt16(y[i]);
+    }
+}
+
+void ToPCM24Scalar(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    for (size_t i = 0; i < count; i++) {
+        Store24(out + i * 6, ToInt24(x[i]));
+        Store24(out + i * 6 + 3, ToInt24(y[i]));
+    }
+}
+
+void ToFloatScalar(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    float* samples = reinterpret_cast<float*>(out);
+    for (size_t i = 0; i < count; i++) {
+        samples[i * 2] = x[i];
+        samples[i * 2 + 1] = y[i];
+    }
+}
+
+void ToPCM16(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    size_t i = 0;
+#if defined(CONVERSION_SSE2)
+    const __m128 scale = _mm_set1_ps(Pcm16Scale);
+    const __m128 min = _mm_set1_ps(Pcm16Min);
+    const __m128 max = _mm_set1_ps(Pcm16Max);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i xi = Round(Scale(_mm_loadu_ps(x + i), scale, min, max));
+        const __m128i yi = Round(Scale(_mm_loadu_ps(y + i), scale, min, max));
+        // x0..x3 y0..y3 to x0 y0 x1 y1 ...
+        const __m128i planar = _mm_packs_epi32(xi, yi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_unpacklo_epi16(planar, _mm_srli_si128(planar, 8)));
+    }
+#elif defined(CONVERSION_NEON)
+    const float32x4_t scale = vdupq_n_f32(Pcm16Scale);
+    const float32x4_t min = vdupq_n_f32(Pcm16Min);
+    const float32x4_t max = vdupq_n_f32(Pcm16Max);
+    for (; i + 4 <= count; i += 4) {
+        int16x4x2_t frames;
+        frames.val[0] = vqmovn_s32(Round(vld1q_f32(x + i), scale, min, max));
+        frames.val[1] = vqmovn_s32(Round(vld1q_f32(y + i), scale, min, max));
+        vst2_s16(reinterpret_cast<int16_t*>(out + i * 4), frames);
+    }
+#endif
+    ToPCM16Scalar(x + i, y + i, count - i, out + i * 4);
+}
+
+void ToPCM24(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    size_t i = 0;
+#if defined(CONVERSION_SSE2)
+    const __m128 scale = _mm_set1_ps(Pcm32Scale);
+    const __m128 min = _mm_set1_ps(Pcm32Min);
+    const __m128 max = _mm_set1_ps(Pcm32Max);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i xi = _mm_srai_epi32(Round(Scale(_mm_loadu_ps(x + i), scale, min, max)), 8);
+        const __m128i yi = _mm_srai_epi32(Round(Scale(_mm_loadu_ps(y + i), scale, min, max)), 8);
+        Store24(out + i * 6, _mm_unpacklo_epi32(xi, yi));
+        Store24(out + i * 6 + 12, _mm_unpackhi_epi32(xi, yi));
+    }
+#elif defined(CONVERSION_NEON)
+    const float32x4_t scale = vdupq_n_f32(Pcm32Scale);
+    const float32x4_t min = vdupq_n_f32(Pcm32Min);
+    const float32x4_t max = vdupq_n_f32(Pcm32Max);
+    for (; i + 4 <= count; i += 4) {
+        const int32x4_t xi = vshrq_n_s32(Round(vld1q_f32(x + i), scale, min, max), 8);
+        const int32x4_t yi = vshrq_n_s32(Round(vld1q_f32(y + i), scale, min, max), 8);
+        Store24(out + i * 6, vzip1q_s32(xi, yi));
+        Store24(out + i * 6 + 12, vzip2q_s32(xi, yi));
+    }
+#endif
+    ToPCM24Scalar(x + i, y + i, count - i, out + i * 6);
+}
+
+void ToFloat(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    size_t i = 0;
+#if defined(CONVERSION_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        const __m128 xs = _mm_loadu_ps(x + i);
+        const __m128 ys = _mm_loadu_ps(y + i);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + i * 8), _mm_unpacklo_ps(xs, ys));
+        _mm_storeu_ps(reinterpret_cast<float*>(out + i * 8 + 16), _mm_unpackhi_ps(xs, ys));
+    }
+#elif defined(CONVERSION_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t frames;
+        frames.val[0] = vld1q_f32(x + i);
+        frames.val[1] = vld1q_f32(y + i);
+        vst2q_f32(reinterpret_cast<float*>(out + i * 8), frames);
+    }
+#endif
+    ToFloatScalar(x + i, y + i, count - i, out + i * 8);
+}
+}  // namespace SampleConversion
+}  // namespace AudioRender
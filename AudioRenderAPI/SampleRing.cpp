@@ -0,0 +1,73 @@
+#include "pch.h"
+
+#include <new>
+
+#include "SampleRing.hpp"
+
+namespace AudioRender
+{
+SampleRing::~SampleRing()
+{
+    if (m_slab) ::operator delete(m_slab, std::align_val_t(CacheLine));
+}
+
+void SampleRing::Allocate(size_t size, size_t count)
+{
+    if (m_slab) ::operator delete(m_slab, std::align_val_t(CacheLine));
+
+    m_slotSize = size;
+    m_stride = (size + CacheLine - 1) & ~(CacheLine - 1);
+    m_count = count ? count : 1;
+    m_slab = static_cast<uint8_t*>(::operator new(m_stride * m_count, std::align_val_t(CacheLine)));
+    m_write.store(0, std::memory_order_relaxed);
+    m_read.store(0, std::memory_order_relaxed);
+    m_readCache = 0;
+    m_writeCache = 0;
+}
+
+uint8_t* SampleRing::Back()
+{
+    const size_t write = m_write.load(std::memory_order_relaxed);
+    if (write - m_readCache >= m_count) {
+        m_readCache = m_read.load(std::memory_order_acquire);
+        if (write - m_readCache >= m_count) return nullptr;
+    }
+    return m_slab + (write % m_count) * m_stride;
+}
+
+void SampleRing::Push()
+{
+    // slot contents become visible to the consumer with the index
+    m_write.store(m_write.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const uint8_t* SampleRing::Front()
+{
+    const size_t read = m_read.load(std::memory_order_relaxed);
+    if (read == m_writeCache) {
+        m_writeCache = m_write.load(std::memory_order_acquire);
+        if (read == m_writeCache) return nullptr;
+    }
+    return m_slab + (read % m_count) * m_stride;
+}
+
+void SampleRing::Pop()
+{
+    // producer may reuse the slot once it sees the index
+    m_read.store(m_read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void SampleRing::Discard()
+{
+    m_writeCache = m_write.load(std::memory_order_acquire);
+    m_read.store(m_writeCache, std::memory_order_release);
+}
+
+size_t SampleRing::Size() const
+{
+    // read index is loaded first, so it can not be ahead of the write index
+    const size_t read = m_read.load(std::memory_order_acquire);
+    const size_t write = m_write.load(std::memory_order_acquire);
+    return write - read;
+}
+}  // namespace AudioRender
@@ -0,0 +1,158 @@
+#include "pch.h"
+
+#include <cmath>
+
+#include "Simplifier.hpp"
+
+namespace AudioRender
+{
+static inline bool samePoint(Point p0, Point p1) { return p0.x == p1.x && p0.y == p1.y; }
+
+static inline float distance(Point p0, Point p1)
+{
+    const float dx = p1.x - p0.x;
+    const float dy = p1.y - p0.y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+// Distance from p to segment a-b. Segment distance keeps points where a run turns back on itself.
+static float segmentDistance(Point p, Point a, Point b)
+{
+    const float dx = b.x - a.x;
+    const float dy = b.y - a.y;
+    const float lenSq = dx * dx + dy * dy;
+    if (lenSq == 0) return distance(p, a);
+
+    float t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / lenSq;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    return distance(p, {a.x + t * dx, a.y + t * dy});
+}
+
+Simplifier::Stats Simplifier::Simplify(const DisplayList& list, DisplayList& out, float tolerance, FrameArena* arena)
+{
+    Stats stats;
+
+    if (out.IsQuantized()) out.SetQuantized(false);
+    out.Clear(list.Origin());
+    m_run.clear();
+
+    // Current point of the output and whether the beam is on it after a line
+    Point current = list.Origin();
+    bool onLine = false;
+
+    // Sync points are added when something is drawn from them
+    bool syncPending = false;
+    Point syncPoint;
+    auto addPendingSync = [&]() {
+        if (!syncPending) return;
+        out.AddSync(syncPoint);
+        current = syncPoint;
+        syncPending = false;
+    };
+    auto flushRun = [&]() {
+        if (m_run.empty()) return;
+        FlushRun(out, tolerance);
+        current = m_run.back();
+        onLine = true;
+        m_run.clear();
+    };
+
+    DisplayList::Reader reader(list, arena);
+    DisplayList::Primitive p;
+    while (reader.Next(p)) {
+        stats.primitivesBefore++;
+        switch (p.type) {
+            case DisplayList::Primitive::Type::DRAW_SYNC:
+                // beam is already there
+                if (!m_run.empty() && samePoint(p.p, m_run.back())) break;
+                if (m_run.empty() && onLine && !syncPending && samePoint(p.p, current)) break;
+
+                flushRun();
+                syncPending = true;
+                syncPoint = p.p;
+                break;
+            case DisplayList::Primitive::Type::DRAW_LINE:
+                if (p.intensity != p.toIntensity) {
+                    // intensity ramps are kept as they are, like curves
+                    flushRun();
+                    addPendingSync();
+                    out.AddLine(p.toPoint, p.intensity, p.toIntensity);
+                    current = p.toPoint;
+                    onLine = true;
+                    break;
+                }
+                if (!m_run.empty() && p.intensity != m_runIntensity) flushRun();
+                if (m_run.empty()) {
+                    addPendingSync();
+                    m_run.push_back(current);
+                    m_runIntensity = p.intensity;
+                }
+                m_run.push_back(p.toPoint);
+                break;
+            case DisplayList::Primitive::Type::DRAW_CURVE:
+                flushRun();
+                addPendingSync();
+                out.AddCubic(p.control1, p.control2, p.toPoint, p.intensity);
+                current = p.toPoint;
+                onLine = true;
+                break;
+            case DisplayList::Primitive::Type::DRAW_CIRCLE:
+                flushRun();
+                addPendingSync();
+                out.AddCircle(p);
+                // beam stops on the circle
+                onLine = false;
+                break;
+            case DisplayList::Primitive::Type::DRAW_PARAMETRIC:
+                flushRun();
+                addPendingSync();
+                out.AddParametric(p);
+                onLine = false;
+                break;
+        }
+    }
+    flushRun();
+    // sync point without drawing after it is not needed, unless there is nothing else
+    if (out.Empty()) addPendingSync();
+
+    stats.primitivesAfter = out.Size();
+    return stats;
+}
+
+void Simplifier::FlushRun(DisplayList& out, float tolerance)
+{
+    // End points are always kept, a run of zero length segments stays as a dot
+    const size_t count = m_run.size();
+    m_keep.assign(count, false);
+    m_keep[0] = true;
+    m_keep[count - 1] = true;
+
+    // Douglas-Peucker, ranges are processed from a stack instead of recursion
+    m_ranges.clear();
+    m_ranges.push_back({0, count - 1});
+    while (!m_ranges.empty()) {
+        const auto range = m_ranges.back();
+        m_ranges.pop_back();
+        if (range.second - range.first < 2) continue;
+
+        float maxDistance = 0;
+        size_t farthest = range.first;
+        for (size_t i = range.first + 1; i < range.second; i++) {
+            const float d = segmentDistance(m_run[i], m_run[range.first], m_run[range.second]);
+            if (d > maxDistance) {
+                maxDistance = d;
+                farthest = i;
+            }
+        }
+        if (maxDistance > tolerance) {
+            m_keep[farthest] = true;
+            m_ranges.push_back({range.first, farthest});
+            m_ranges.push_back({farthest, range.second});
+        }
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (m_keep[i]) out.AddLine(m_run[i], m_runIntensity);
+    }
+}
+}  // namespace AudioRender
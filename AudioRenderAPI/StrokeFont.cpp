@@ -0,0 +1,158 @@
+#include "pch.h"
+
+#include "StrokeFont.hpp"
+
+namespace AudioRender
+{
+namespace StrokeFont
+{
+// Glyphs of characters 32 - 126. Each point is two digits, x from the left edge and y from the cap line:
+// 0 is the cap line, 2 the x-height, 6 the baseline and 8 the descender line. Points of a stroke are written
+// back to back and strokes are separated by spaces.
+static constexpr const char* Glyphs[] = {
+    "",                                // space
+    "2023 2526",                       // !
+    "1012 3032",                       // "
+    "1016 3036 0242 0444",             // #
+    "413010010213334445361605 2027",   // $
+    "0640 0010110100 3545463635",      // %
+    "4612112031320405162643",          // &
+    "2022",                            // '
+    "30212536",                        // (
+    "10212516",                        // )
+    "2125 0244 0442",                  // *
+    "2125 0343",                       // +
+    "252617",                          // ,
+    "0343",                            // -
+    "2526",                            // .
+    "0640",                            // /
+    "0040460600 0640",                 // 0
+    "112026 1636",                     // 1
+    "004043030646",                    // 2
+    "00404606 1343",                   // 3
+    "36300444",                        // 4
+    "400003434606",                    // 5
+    "400006464303",                    // 6
+    "004016",                          // 7
+    "0040460600 0343",                 // 8
+    "430300404606",                    // 9
+    "2122 2526",                       // :
+    "2122 252617",                     // ;
+    "400346",                          // <
+    "0242 0444",                       // =
+    "004306",                          // >
+    "01103041423223 2526",             // ?
+    "343212144440000646",              // @
+    "0602204246 0444",                 // A
+    "06003041423303 3344453606",       // B
+    "40000646",                        // C
+    "00304244360600",                  // D
+    "40000646 0333",                   // E
+    "400006 0333",                     // F
+    "41400006464323",                  // G
+    "0006 4046 0343",                  // H
+    "2026 1030 1636",                  // I
+    "40460604",                        // J
+    "0006 400346",                     // K
+    "000646",                          // L
+    "0600234046",                      // M
+    "06004640",                        // N
+    "103041453616050110",              // O
+    "06003041423303",                  // P
+    "103041453616050110 2546",         // Q
+    "06003041423303 2346",             // R
+    "413010010213334445361605",        // S
+    "0040 2026",                       // T
+    "000516364540",                    // U
+    "002640",                          // V
+    "0016233640",                      // W
+    "0046 4006",                       // X
+    "002340 2326",                     // Y
+    "00400646",                        // Z
+    "30101636",                        // [
+    "0046",                            // backslash
+    "10303616",                        // ]
+    "122032",                          // ^
+    "0747",                            // _
+    "1021",                            // `
+    "024246060444",                    // a
+    "0006464202",                      // b
+    "42020646",                        // c
+    "4046060242",                      // d
+    "044442020646",                    // e
+    "40201116 0232",                   // f
+    "460602424808",                    // g
+    "0006 024246",                     // h
+    "2226 2021",                       // i
+    "222808 2021",                     // j
+    "0006 420446",                     // k
+    "2026",                            // l
+    "06024246 2226",                   // m
+    "06024246",                        // n
+    "0242460602",                      // o
+    "0802424606",                      // p
+    "4842020646",                      // q
+    "0602 031242",                     // r
+    "420204444606",                    // s
+    "202646 0242",                     // t
+    "02064642",                        // u
+    "022642",                          // v
+    "0216243642",                      // w
+    "0246 4206",                       // x
+    "0226 4218",                       // y
+    "02420646",                        // z
+    "30202213242636",                  // {
+    "2027",                            // |
+    "10202233242616",                  // }
+    "04133443",                        // ~
+};
+
+static constexpr char FirstGlyph = ' ';
+static constexpr int GlyphCount = sizeof(Glyphs) / sizeof(Glyphs[0]);
+static_assert(GlyphCount == '~' - ' ' + 1, "Glyph table must cover printable ASCII");
+
+static inline Point glyphPoint(const char* p) { return {float(p[0] - '0'), float(p[1] - '0' - CapHeight)}; }
+
+void AddGlyph(char c, float intensity, DisplayList& list)
+{
+    int idx = c - FirstGlyph;
+    if (idx < 0 || idx >= GlyphCount) idx = '?' - FirstGlyph;
+
+    const char* p = Glyphs[idx];
+    while (*p) {
+        if (*p == ' ') {
+            p++;
+            continue;
+        }
+        list.AddSync(glyphPoint(p));
+        for (p += 2; *p && *p != ' '; p += 2) list.AddLine(glyphPoint(p), intensity);
+    }
+}
+
+float TextWidth(const char* text)
+{
+    int width = 0;
+    int line = 0;
+    for (; *text; text++) {
+        if (*text == '\n') {
+            line = 0;
+            continue;
+        }
+        line++;
+        if (line > width) width = line;
+    }
+    // glyphs are 4 units wide, last one has no spacing after it
+    return width ? float(width * Advance - 2) : 0.0f;
+}
+
+float TextHeight(const char* text)
+{
+    if (!*text) return 0;
+    int lines = 1;
+    for (; *text; text++) {
+        if (*text == '\n') lines++;
+    }
+    return float(CapHeight + (lines - 1) * LineHeight);
+}
+}  // namespace StrokeFont
+}  // namespace AudioRender
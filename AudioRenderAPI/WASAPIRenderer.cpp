@@ -502,21 +502,14 @@ HRESULT WASAPIRenderer::GetToneSample(UINT32 FramesAvailable)
         hr = S_FALSE;
 
     } else {
-        UINT32 ActualFramesToRead = m_audioSource->GetBufferLength() / m_MixFormat->nBlockAlign;
-        UINT32 ActualBytesToRead = ActualFramesToRead * m_MixFormat->nBlockAlign;
-
-        UINT32 batches = FramesAvailable / ActualFramesToRead;
-        if (batches > 0) {
-            hr = m_AudioRenderClient->GetBuffer(batches * ActualFramesToRead, &Data);
-            if (SUCCEEDED(hr)) {
-                for (UINT32 i = 0; i < batches && SUCCEEDED(hr); i++) {
-                    hr = m_audioSource->FillSampleBuffer(ActualBytesToRead, Data);
-                    Data += ActualBytesToRead;
-                }
-                if (SUCCEEDED(hr)) {
-                    hr = m_AudioRenderClient->ReleaseBuffer(batches * ActualFramesToRead, 0);
-                }
-            }
+        // Generator writes to the device buffer directly, as much of the available space as it can fill
+        hr = m_AudioRenderClient->GetBuffer(FramesAvailable, &Data);
+        if (SUCCEEDED(hr)) {
+            UINT32 BytesWritten = 0;
+            hr = m_audioSource->ProduceSamples(FramesAvailable * m_MixFormat->nBlockAlign, Data, &BytesWritten);
+            const UINT32 FramesWritten = SUCCEEDED(hr) ? BytesWritten / m_MixFormat->nBlockAlign : 0;
+            const HRESULT releaseHr = m_AudioRenderClient->ReleaseBuffer(FramesWritten, 0);
+            if (SUCCEEDED(hr)) hr = releaseHr;
         }
     }
 
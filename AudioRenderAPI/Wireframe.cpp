@@ -0,0 +1,276 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+#include "Wireframe.hpp"
+#include "DrawDevice.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WIREFRAME_SSE2
+#endif
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define CLAMP(x, minx, maxx) MAX(minx, MIN(maxx, x))
+
+namespace AudioRender
+{
+// Relative depth difference within which an edge is not hidden by a triangle, edges lie on their own triangles
+const float DepthBias = 0.01f;
+
+static double nowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+void LineMesh::UpdateAdjacency()
+{
+    auto key = [](uint32_t v0, uint32_t v1) { return v0 < v1 ? (uint64_t(v0) << 32) | v1 : (uint64_t(v1) << 32) | v0; };
+
+    std::unordered_map<uint64_t, size_t> edgeIndex;
+    for (size_t e = 0; e < EdgeCount(); e++) edgeIndex[key(edges[2 * e], edges[2 * e + 1])] = e;
+
+    edgeTriangles.assign(edges.size(), -1);
+    for (size_t t = 0; t < TriangleCount(); t++) {
+        for (int k = 0; k < 3; k++) {
+            auto it = edgeIndex.find(key(triangles[3 * t + k], triangles[3 * t + (k + 1) % 3]));
+            if (it == edgeIndex.end()) continue;
+            int32_t* slots = &edgeTriangles[2 * it->second];
+            if (slots[0] < 0) {
+                slots[0] = int32_t(t);
+            } else if (slots[1] < 0) {
+                slots[1] = int32_t(t);
+            }
+        }
+    }
+}
+
+// Transforms vertices to clip space, four components at a time
+static void transformVertices(const glm::mat4& m, const glm::vec3* in, glm::vec4* out, size_t count)
+{
+#ifdef WIREFRAME_SSE2
+    const __m128 c0 = _mm_loadu_ps(&m[0][0]);
+    const __m128 c1 = _mm_loadu_ps(&m[1][0]);
+    const __m128 c2 = _mm_loadu_ps(&m[2][0]);
+    const __m128 c3 = _mm_loadu_ps(&m[3][0]);
+    for (size_t i = 0; i < count; i++) {
+        const __m128 xy = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[i].x)), _mm_mul_ps(c1, _mm_set1_ps(in[i].y)));
+        const __m128 zw = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(in[i].z)), c3);
+        _mm_storeu_ps(&out[i].x, _mm_add_ps(xy, zw));
+    }
+#else
+    for (size_t i = 0; i < count; i++) out[i] = m * glm::vec4(in[i], 1.0f);
+#endif
+}
+
+// Liang-Barsky in homogeneous coordinates against -w <= x, y, z <= w. Returns false if the edge is outside,
+// otherwise the part inside is [t0, t1].
+static bool clipEdge(const glm::vec4& a, const glm::vec4& b, float& t0, float& t1)
+{
+    const float da[6] = {a.w + a.x, a.w - a.x, a.w + a.y, a.w - a.y, a.w + a.z, a.w - a.z};
+    const float db[6] = {b.w + b.x, b.w - b.x, b.w + b.y, b.w - b.y, b.w + b.z, b.w - b.z};
+
+    t0 = 0;
+    t1 = 1;
+    for (int i = 0; i < 6; i++) {
+        if (da[i] < 0 && db[i] < 0) return false;
+        if (da[i] < 0) {
+            t0 = MAX(t0, da[i] / (da[i] - db[i]));
+        } else if (db[i] < 0) {
+            t1 = MIN(t1, da[i] / (da[i] - db[i]));
+        }
+    }
+    return t0 < t1;
+}
+
+// Normalized device coordinates [-1, 1] to the viewport of the draw device, y grows downwards
+static inline Point toViewport(float x, float y) { return {x * 0.5f, -y * 0.5f}; }
+
+void WireframeRenderer::SetHiddenLineRemoval(bool enabled, int resolution)
+{
+    m_hiddenLineRemoval = enabled;
+    m_depthResolution = CLAMP(resolution, 16, 4096);
+}
+
+void WireframeRenderer::UpdateFacing(const LineMesh& mesh)
+{
+    m_frontFacing.resize(mesh.TriangleCount());
+    for (size_t t = 0; t < mesh.TriangleCount(); t++) {
+        const glm::vec4& a = m_clip[mesh.triangles[3 * t]];
+        const glm::vec4& b = m_clip[mesh.triangles[3 * t + 1]];
+        const glm::vec4& c = m_clip[mesh.triangles[3 * t + 2]];
+        if (a.w <= 0 || b.w <= 0 || c.w <= 0) {
+            // crosses the camera plane, kept
+            m_frontFacing[t] = 1;
+            continue;
+        }
+        const float ax = a.x / a.w, ay = a.y / a.w;
+        const float area = (b.x / b.w - ax) * (c.y / c.w - ay) - (b.y / b.w - ay) * (c.x / c.w - ax);
+        m_frontFacing[t] = area > 0;
+    }
+}
+
+void WireframeRenderer::RasterizeDepth(const LineMesh& mesh, bool frontOnly)
+{
+    const int res = m_depthResolution;
+    m_depth.assign(size_t(res) * res, 0.0f);
+
+    for (size_t t = 0; t < mesh.TriangleCount(); t++) {
+        if (frontOnly && !m_frontFacing[t]) continue;
+
+        float sx[3], sy[3], iw[3];
+        bool behind = false;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec4& c = m_clip[mesh.triangles[3 * t + k]];
+            if (c.w <= 0) {
+                behind = true;
+                break;
+            }
+            iw[k] = 1.0f / c.w;
+            sx[k] = (c.x * iw[k] + 1) * 0.5f * res;
+            sy[k] = (c.y * iw[k] + 1) * 0.5f * res;
+        }
+        // triangles crossing the camera plane do not hide anything
+        if (behind) continue;
+
+        const float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+        if (fabsf(area) < 1e-6f) continue;
+        const float invArea = 1.0f / area;
+
+        const int x0 = MAX(0, (int)floorf(MIN(sx[0], MIN(sx[1], sx[2]))));
+        const int x1 = MIN(res - 1, (int)ceilf(MAX(sx[0], MAX(sx[1], sx[2]))));
+        const int y0 = MAX(0, (int)floorf(MIN(sy[0], MIN(sy[1], sy[2]))));
+        const int y1 = MIN(res - 1, (int)ceilf(MAX(sy[0], MAX(sy[1], sy[2]))));
+        for (int y = y0; y <= y1; y++) {
+            const float py = y + 0.5f;
+            float* row = &m_depth[size_t(y) * res];
+            for (int x = x0; x <= x1; x++) {
+                const float px = x + 0.5f;
+                // barycentric weights, all positive inside whatever the winding
+                const float w0 = ((sx[1] - px) * (sy[2] - py) - (sy[1] - py) * (sx[2] - px)) * invArea;
+                const float w1 = ((sx[2] - px) * (sy[0] - py) - (sy[2] - py) * (sx[0] - px)) * invArea;
+                const float w2 = 1 - w0 - w1;
+                if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+                row[x] = MAX(row[x], w0 * iw[0] + w1 * iw[1] + w2 * iw[2]);
+            }
+        }
+    }
+}
+
+bool WireframeRenderer::Visible(float x, float y, float invW) const
+{
+    const int px = (int)x;
+    const int py = (int)y;
+    if (px < 0 || py < 0 || px >= m_depthResolution || py >= m_depthResolution) return true;
+    return invW >= m_depth[size_t(py) * m_depthResolution + px] * (1 - DepthBias);
+}
+
+void WireframeRenderer::AddSegment(Point p0, Point p1)
+{
+    // continue the previous path if the segment starts where it ended
+    if (!m_counts.empty() && m_points.back().x == p0.x && m_points.back().y == p0.y) {
+        m_points.push_back(p1);
+        m_counts.back()++;
+        return;
+    }
+    m_points.push_back(p0);
+    m_points.push_back(p1);
+    m_counts.push_back(2);
+}
+
+bool WireframeRenderer::AddVisibleParts(const glm::vec4& c0, const glm::vec4& c1)
+{
+    // Inverse w and the position are affine in screen space, so samples are interpolated there
+    const float res = float(m_depthResolution);
+    const float iw0 = 1.0f / c0.w, iw1 = 1.0f / c1.w;
+    const float x0 = c0.x * iw0, y0 = c0.y * iw0;
+    const float x1 = c1.x * iw1, y1 = c1.y * iw1;
+    const float pixels = sqrtf((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)) * 0.5f * res;
+    const int steps = MAX(1, (int)ceilf(pixels));
+
+    // run ends are computed from t so that the end point of the edge is exact and the next edge can join it
+    auto pointAt = [&](int i) { return i == steps ? toViewport(x1, y1) : toViewport(x0 + (x1 - x0) * i / steps, y0 + (y1 - y0) * i / steps); };
+
+    bool visible = false;
+    int runStart = -1;
+    for (int i = 0; i <= steps + 1; i++) {
+        bool sampleVisible = false;
+        if (i <= steps) {
+            const float t = float(i) / steps;
+            const float x = x0 + (x1 - x0) * t;
+            const float y = y0 + (y1 - y0) * t;
+            sampleVisible = Visible((x + 1) * 0.5f * res, (y + 1) * 0.5f * res, iw0 + (iw1 - iw0) * t);
+        }
+        if (sampleVisible) {
+            if (runStart < 0) runStart = i;
+            continue;
+        }
+        if (runStart >= 0 && i - 1 > runStart) {
+            AddSegment(pointAt(runStart), pointAt(i - 1));
+            visible = true;
+        }
+        runStart = -1;
+    }
+    return visible;
+}
+
+WireframeRenderer::Stats WireframeRenderer::Project(const LineMesh& mesh)
+{
+    const double start = nowMs();
+    Stats stats;
+    stats.edges = mesh.EdgeCount();
+    m_points.clear();
+    m_counts.clear();
+
+    const glm::mat4 mvp = m_projection * m_view * m_model;
+    m_clip.resize(mesh.vertices.size());
+    transformVertices(mvp, mesh.vertices.data(), m_clip.data(), mesh.vertices.size());
+
+    const bool cull = m_backFaceCulling && mesh.edgeTriangles.size() == mesh.edges.size();
+    if (cull) UpdateFacing(mesh);
+    if (m_hiddenLineRemoval) RasterizeDepth(mesh, cull);
+
+    for (size_t e = 0; e < mesh.EdgeCount(); e++) {
+        if (cull) {
+            const int32_t t0 = mesh.edgeTriangles[2 * e];
+            const int32_t t1 = mesh.edgeTriangles[2 * e + 1];
+            if (t0 >= 0 && !m_frontFacing[t0] && (t1 < 0 || !m_frontFacing[t1])) {
+                stats.backFacing++;
+                continue;
+            }
+        }
+
+        const glm::vec4& a = m_clip[mesh.edges[2 * e]];
+        const glm::vec4& b = m_clip[mesh.edges[2 * e + 1]];
+        float t0, t1;
+        if (!clipEdge(a, b, t0, t1)) {
+            stats.clipped++;
+            continue;
+        }
+        const glm::vec4 c0 = t0 > 0 ? a + (b - a) * t0 : a;
+        const glm::vec4 c1 = t1 < 1 ? a + (b - a) * t1 : b;
+
+        if (m_hiddenLineRemoval) {
+            if (!AddVisibleParts(c0, c1)) stats.hidden++;
+        } else {
+            AddSegment(toViewport(c0.x / c0.w, c0.y / c0.w), toViewport(c1.x / c1.w, c1.y / c1.w));
+        }
+    }
+
+    stats.paths = m_counts.size();
+    stats.elapsedMs = float(nowMs() - start);
+    return stats;
+}
+
+WireframeRenderer::Stats WireframeRenderer::Draw(const LineMesh& mesh, IDrawDevice& device)
+{
+    Stats stats = Project(mesh);
+    if (!m_counts.empty()) device.DrawPaths(m_points.data(), m_counts.data(), m_counts.size());
+    return stats;
+}
+}  // namespace AudioRender
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <array>
+#include <thread>
 #include <condition_variable>
 
 #include "IAudioGenerator.hpp"
 #include "DrawDevice.hpp"
+#include "MotionProfile.hpp"
+#include "SampleConversion.hpp"
+#include "SampleRing.hpp"
 
 namespace AudioRender
 {
@@ -23,11 +29,41 @@ public:
     {
         m_xScale = xscale;
         m_yScale = yscale;
+        m_preparedGeneration = 0;
     }
 
     void setFixedRenderingRate(bool fixedRate) { m_fixedRate = fixedRate; }
+
+    // Scales line and circle segment density of each frame so that it refreshes at the given rate.
+    // Heavy frames lose detail and light frames are drawn slower. 0 disables and uses the default density.
+    // Achieved rate and the applied density are reported in the frame statistics.
+    void setTargetRefreshRate(float hz);
     void setIdleBox(bool idleBox) { m_idleBox = idleBox; }
 
+    // In pipelined mode Submit hands the display list over to an encoder thread and returns
+    // immediately, so the next frame can be built while the previous one is encoded. Submit blocks
+    // only when the previous frame has not been picked up by the encoder yet.
+    // Scale and rendering rate should be configured before enabling.
+    void setPipelined(bool pipelined);
+
+    // In progressive mode a changed frame is queued while it is encoded, a buffer at a time, instead of after the
+    // whole frame is encoded. Large frames start playing sooner and the queue does not run dry on frame changes.
+    void setProgressiveSubmit(bool progressive) { m_progressive = progressive; }
+
+    // In just-in-time mode Submit prepares the frame and publishes it to the audio thread, which encodes the samples
+    // when FillSampleBuffer asks for them, continuing from where the previous buffer ended. A newly published frame
+    // is picked up on the next buffer from the same position in the frame, so the newest frame is shown within one
+    // buffer instead of after the queued ones. Encoding cost of a buffer follows its length. Pipelined and
+    // progressive modes and the target refresh rate do not apply. Should be set before the output is started.
+    void setJustInTime(bool justInTime);
+
+    // In motion profile mode samples of connected lines are placed by the motion of the beam instead of evenly.
+    // The beam slows down into corners by how sharply they turn and dwells on sharp ones, and speeds up to the line
+    // speed again after them, so corners stay sharp through the output filters. Lines with an intensity ramp are
+    // sampled at the spacing of the intensity along them. Lines stop at rest before a primitive of another layer.
+    // Should be set before frames are submitted.
+    void setMotionProfile(bool motionProfile);
+
     //==========================================================
     // IDrawDevice interface
     bool WaitSync(int timeout) override;
@@ -45,31 +81,187 @@ public:
 
     HRESULT Initialize(UINT32 FramesPerPeriod, WAVEFORMATEX* wfx) override;
     HRESULT FillSampleBuffer(UINT32 BytesToRead, BYTE* Data) override;
+    // Fills the whole span. Queued buffers are copied out as far as they go, partly output buffers continue on the
+    // next call, and silence fills the rest. In just-in-time mode the samples are encoded straight to the span.
+    HRESULT ProduceSamples(UINT32 BytesAvailable, BYTE* Data, UINT32* BytesWritten) override;
 
 private:
     // Graphics encoding to audio
-    void EncodeAudio(const std::vector<GraphicsPrimitive>& ops);
+    void EncodeFrame(DisplayList& list);
+    void EncodeAudio(const DisplayList& list);
+    void CountLayerSamples(const DisplayList& list, float detail, size_t* samples);
+    // Average samples of a refresh, when layers are drawn on every refresh divisor
+    float RefreshSamples(const DisplayList& list, float detail);
+    void FitDetail(const DisplayList& list);
+    Transform DeviceTransform() const override { return Transform::Scale(m_xScale, m_yScale); }
+    bool LatchesTransformSlots() const override { return true; }
+    struct InstanceSample {
+        Point p;
+        bool fixed;  // sync samples do not move with the instance
+    };
     struct EncodeCtx {
         bool syncPoint;
+        // samples are collected here instead of the frame when set
+        std::vector<InstanceSample>* capture;
+        int slot;  // transform slot of the samples, -1 for none
+        // line waiting for the primitive after it in motion profile mode
+        MotionProfile::State motion;
     };
+    int EncodePrimitive(const GraphicsPrimitive& p, EncodeCtx& ctx);
+    int EncodeInstance(const DisplayList::Reader::Instance& instance, EncodeCtx& ctx);
     int EncodeCircle(const GraphicsPrimitive& p, EncodeCtx& ctx);
     int EncodeLine(const GraphicsPrimitive& p, EncodeCtx& ctx);
+    int EncodeCurve(const GraphicsPrimitive& p, EncodeCtx& ctx);
+    int EncodeParametric(const GraphicsPrimitive& p, EncodeCtx& ctx);
     int EncodeSync(const GraphicsPrimitive& p, EncodeCtx& ctx);
-    bool AddToBuffer(float x, float y, EncodeCtx& ctx);
+    // Motion profile mode lines. Samples of a line are added when the next primitive is encoded or the line is
+    // finished at the end of the path.
+    int EncodeMotionLine(const GraphicsPrimitive& p, EncodeCtx& ctx);
+    int FinishMotionLine(EncodeCtx& ctx);
+    void AddMotionPoints(size_t count, int slot, EncodeCtx& ctx);
+    MotionProfile::Line MotionLine(const GraphicsPrimitive& p, float detail) const;
+    // Fixed samples stay in place when the samples around them are moved by an instance or a transform slot
+    bool AddToBuffer(float x, float y, EncodeCtx& ctx, bool fixed = false);
+    void WriteSample(uint8_t* buffer, float x, float y);
+    // Converts the points of the run to the direct output as far as it fits and the rest to m_frameSamples
+    void FlushRun();
+    // Size of the frame samples including the run and the direct output
+    size_t FrameBytes() const { return m_directUsed + m_frameSamples.size() + m_runCount * m_wfx.nBlockAlign; }
+    void QueueFrame();
+    void EndRefresh();
+    // Queues size bytes of the frame samples starting from offset
+    void QueueSamples(size_t offset, size_t size);
     void QueueBuffer();
-    void FillIdle(EncodeCtx& ctx);
+    void FillIdle();
+    // Buffer being filled, a slot of the render ring or the overflow buffer when the ring is full
+    uint8_t* WriteBuffer();
+
+    // Sample on a transform slot. Position is stored without the slot transform, which is applied to the output
+    // buffer by FillSampleBuffer. Offset is in bytes.
+    //
+    // Frames are prepared with the slot transforms of their submit, so that clipping and sampling see the size on
+    // the output. Their samples are brought back to the slot coordinates by the slot bases.
+    struct LatchedSample {
+        size_t offset;
+        int slot;
+        Point p;
+    };
+    // Slot transforms for samples that have the device scale applied
+    void ReadLatchTransforms(Transform* slots);
+    // Undo the slot transforms of the prepared frame on its samples
+    void SlotBases(Transform* bases) const;
+    Transform m_frameSlotBases[DisplayList::MaxTransformSlots];
+    const Transform* m_slotBases = m_frameSlotBases;  // bases of the frame being encoded
+    // Samples with offsets in [begin, end) are written to data at their offset - begin
+    void LatchSamples(const std::vector<LatchedSample>& latched, size_t begin, size_t end, uint8_t* data, const Transform* slots);
+
+    // Encoded samples of the last submitted frame. Reused as long as the display list does not change.
+    std::vector<uint8_t> m_frameSamples;
+    uint64_t m_frameGeneration = 0;
+    // Encoders add points to the run, which is converted in batches. Must be flushed before m_frameSamples is used.
+    static constexpr size_t RunLength = 256;
+    alignas(16) float m_runX[RunLength];
+    alignas(16) float m_runY[RunLength];
+    size_t m_runCount = 0;
+    // Output memory that samples are written to before m_frameSamples, used by just-in-time encoding
+    uint8_t* m_direct = nullptr;
+    size_t m_directSize = 0;
+    size_t m_directUsed = 0;
+    // Layers are stored back to back, samples of layer n are between offsets n and n + 1
+    size_t m_layerOffsets[DisplayList::MaxLayers + 1] = {};
+    uint32_t m_refreshCount = 0;
+    bool m_progressive = false;
+    // Samples of the frame on transform slots, in offset order
+    std::vector<LatchedSample> m_frameLatched;
+
+    // Samples of encoded instances. Instances that differ only by translation share the samples. Output of the last
+    // placement is kept as well, so an instance drawn at the same position again (static text) is a copy.
+    struct InstanceBlock {
+        // Blocks outlive frames, so an address is matched only while the shape it belonged to is alive
+        const DisplayList* shape;
+        std::weak_ptr<const DisplayList> shapeRef;
+        float a, b, c, d;
+        float radiusScale;
+        float intensity;
+        float detail;
+        bool syncPointBefore;
+        bool syncPointAfter;
+        int points;
+        std::vector<InstanceSample> samples;
+        float tx, ty;
+        std::vector<uint8_t> placed;
+    };
+    std::vector<InstanceBlock> m_instanceBlocks;
+
+    ParametricSampler m_parametricSampler;
+    // Sampler for counting samples of a prepared frame, which is done on the application thread in just-in-time mode
+    ParametricSampler m_countSampler;
+    bool m_motionProfile = false;
+    MotionProfile m_motion;
+    // Planner for counting, like the parametric sampler
+    MotionProfile m_countMotion;
+
+    // Pipelined mode encoder thread and the frame handoff. Display list of a submitted frame is
+    // copied to m_pendingList and the encoder thread swaps it with m_encodingList when it picks
+    // the frame up.
+    void EncoderThreadMain();
+    std::thread m_encoderThread;
+    std::mutex m_encoderMutex;
+    std::condition_variable m_encoderCv;
+    bool m_pipelined = false;
+    bool m_framePending = false;     // frame submitted but not picked up by the encoder thread
+    bool m_pendingListNew = false;   // m_pendingList has content that encoder has not seen
+    uint64_t m_handoffGeneration = 0;
+    DisplayList m_pendingList;
+    DisplayList m_encodingList;
+
+    // Just-in-time mode. Frames are handed to the audio thread through three lists without locking: Submit fills the
+    // back list and swaps it with the published one, FillSampleBuffer swaps the list it reads with the published one
+    // when a new frame has been published.
+    void PublishFrame(DisplayList& frame);
+    bool TakePublishedFrame();
+    // Encodes the next primitive of the current refresh. Returns false if a refresh ended without
+    // drawing anything.
+    bool EncodeNextPrimitive();
+    void FillJustInTime(uint8_t* data, size_t size);
+    static constexpr uint32_t NewFrameFlag = 4;
+    bool m_justInTime = false;
+    std::array<DisplayList, 3> m_jitLists;
+    std::atomic<uint32_t> m_jitPublished{1};  // index of the published list and NewFrameFlag until it is taken
+    uint32_t m_jitBack = 0;                   // used by the application
+    uint32_t m_jitFront = 2;                  // used by the audio thread
+    uint64_t m_jitGeneration = 0;
+    // Audio thread encoding state
+    std::unique_ptr<DisplayList::Reader> m_jitReader;
+    EncodeCtx m_jitCtx{false, nullptr, -1};
+    size_t m_jitPosition = 0;  // primitives read on the current refresh
+    bool m_jitDrawn = false;   // current refresh has added samples
+    int m_jitLayer = -1;       // layer of the last primitive read
+    size_t m_jitOffset = 0;    // bytes of m_frameSamples that have been output
+    Transform m_jitSlots[DisplayList::MaxTransformSlots];
+    Transform m_jitSlotBases[3][DisplayList::MaxTransformSlots];  // bases of the lists
+    // Read positions of the lists, see DisplayList::Reader::ReadPositions
+    std::array<std::vector<DisplayList::Reader::Position>, 3> m_jitPositions;
+    std::array<std::vector<size_t>, 3> m_jitPrimitivePositions;
 
-    // Current buffer that is used to build rendering data
-    std::vector<uint8_t> m_audioBuffer;
+    // Current buffer that is used to build rendering data. Samples are written to the next free slot of the
+    // render ring, or to the overflow buffer to be dropped if the consumer has fallen that far behind.
+    uint8_t* m_writeBuffer = nullptr;
+    std::vector<uint8_t> m_overflowBuffer;
+    std::vector<LatchedSample> m_audioLatched;
     int m_bufferIdx = 0;
     int m_bufferSize;
     bool m_fixedRate = false;
     bool m_idleBox = false;
+    float m_targetRefreshRate = 0;
+    float m_detail = 1.0f;  // segment density factor
 
-    // Buffers that are ready for rendering and can be picked up by the FillSampleBuffer
-    std::array<std::vector<uint8_t>, 128> m_renderBuffer;
-    uint32_t m_readIdx;
-    uint32_t m_writeIdx;
+    // Buffers that are ready for rendering and can be picked up by the FillSampleBuffer. Latched samples of a
+    // buffer are at the index of its slot.
+    static constexpr size_t RenderBufferCount = 128;
+    SampleRing m_renderRing;
+    std::array<std::vector<LatchedSample>, RenderBufferCount> m_renderLatched;
+    size_t m_frontOffset = 0;  // bytes of the front slot that have been output
     HANDLE m_frameEvent;
     uint32_t m_bufferCount;
 
@@ -81,6 +273,8 @@ private:
     };
     void ResolveMixFormatType(WAVEFORMATEX* wfx);
     RenderSampleType m_sampleType = SampleTypeUnknown;
+    // Conversion of the output format, selected when the format is resolved
+    SampleConversion::Converter m_convert = nullptr;
 
     WAVEFORMATEX m_wfx;
     // Amplitude scale
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "DisplayList.hpp"
+
+namespace AudioRender
+{
+class ParametricSampler;
+
+// Clips lines and circles of a list to a rectangle and writes the visible parts to out.
+//
+// Lines are clipped with Liang-Barsky and circles are cut to arcs. Curves and parametric curves that
+// cross the rectangle are flattened to lines and clipped. Primitives that are completely outside are dropped. A sync
+// point is added wherever drawing continues from another location, so that the beam moves blank
+// over the clipped parts. Scratch memory is taken from the arena if given. Parametric curves are flattened with the
+// sampler if given, so that its memory is kept between frames.
+void ClipToRectangle(const DisplayList& list, const Rectangle& rect, DisplayList& out, FrameArena* arena = nullptr,
+                     ParametricSampler* sampler = nullptr);
+}  // namespace AudioRender
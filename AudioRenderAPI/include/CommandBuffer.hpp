@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Geometry.hpp"
+#include "DisplayList.hpp"
+#include "ListRecorder.hpp"
+
+// Win32 maps DrawText to DrawTextA or DrawTextW
+#ifdef DrawText
+#undef DrawText
+#endif
+
+namespace AudioRender
+{
+// Records drawing commands away from the draw device, to be merged into a frame by DrawDevice::SubmitCommandBuffers.
+//
+// A buffer has its own drawing state, so each thread can record into a buffer of its own without locking. Drawing
+// functions work like their IDrawDevice counterparts, each buffer starts from the origin on layer 0 without a
+// transform slot, with identity transform and default intensity. Storage is retained over Reset.
+//
+// Shapes for DrawInstance are looked up with DrawDevice::GetShape before recording starts. Slot transforms are
+// updated on the device with UpdateTransformSlot.
+class CommandBuffer : public ListRecorder
+{
+public:
+    // Glyphs are recorded as lines, the glyph shapes of the device are not shared between threads
+    void DrawText(const char* text, Point position, float scale);
+
+    const DisplayList& Commands() const { return List(); }
+};
+}  // namespace AudioRender
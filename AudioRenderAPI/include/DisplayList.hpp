@@ -0,0 +1,293 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "FrameArena.hpp"
+
+namespace AudioRender
+{
+class ParametricCurve;
+
+// Compact command stream of recorded graphics primitives.
+//
+// Commands are stored as a structure of arrays: one opcode byte per command, a vertex array that is
+// shared between consecutive commands and a parameter array for the per command scalars. A line
+// stores only its end point as the start point is the previous vertex. Vertices can optionally be
+// quantized to 16-bit DAC resolution, which halves the vertex storage.
+class DisplayList
+{
+public:
+    enum class Op : uint8_t {
+        SYNC,       // vertex: new current point
+        LINE,       // vertex: end point, param: intensity
+        LINE_RAMP,  // vertex: end point, params: start intensity, end intensity
+        CIRCLE,     // params: radius, intensity. Centered on the current point.
+        ELLIPSE,    // params: radius, intensity, x axis, y axis. Centered on the current point.
+        TRANSFORM,  // params: transform for the following vertices and circles
+        ARC,        // params: center, radius, intensity, x axis, y axis, start angle, end angle
+        QUAD,       // vertices: control point, end point, param: intensity
+        CUBIC,      // vertices: two control points, end point, param: intensity
+        INSTANCE,   // params: transform, radius scale, intensity. Shape is the next entry of the instance array.
+        LAYER,      // param: layer of the following commands
+        PARAMETRIC, // params: intensity, start, end, transform. Curve is the next entry of the curve array.
+        SLOT,       // param: transform slot of the following commands, -1 for none
+    };
+
+    static constexpr float FullCircle = 6.28318531f;
+    static constexpr int MaxLayers = 8;
+    static constexpr int MaxTransformSlots = 8;
+
+    // Decoded view of a single command
+    struct Primitive {
+        enum class Type { DRAW_CIRCLE, DRAW_LINE, DRAW_SYNC, DRAW_CURVE, DRAW_PARAMETRIC };
+
+        Type type;
+        float r;  // for ellipses radius of a circle with the same area, excluding device transform
+        float intensity;
+        float toIntensity;
+        Point p;
+        Point toPoint;
+        // Circle point at angle t is p + sin(t) * axisX + cos(t) * axisY
+        Point axisX;
+        Point axisY;
+        // Circles are drawn from arcStart to arcEnd, parametric curves from parameter arcStart to arcEnd
+        float arcStart;
+        float arcEnd;
+        // Curves are cubic Beziers from p to toPoint. Quadratic curves are elevated to cubic ones.
+        Point control1;
+        Point control2;
+        // Parametric curve points are transformed by curveTransform. Curve is owned by the list it was read from.
+        const ParametricCurve* curve;
+        Transform curveTransform;
+
+        bool IsArc() const { return arcEnd - arcStart < FullCircle; }
+
+        // Curve point at t in [0, 1]
+        Point CurvePoint(float t) const
+        {
+            const float u = 1 - t;
+            const float w0 = u * u * u;
+            const float w1 = 3 * u * u * t;
+            const float w2 = 3 * u * t * t;
+            const float w3 = t * t * t;
+            return {w0 * p.x + w1 * control1.x + w2 * control2.x + w3 * toPoint.x, w0 * p.y + w1 * control1.y + w2 * control2.y + w3 * toPoint.y};
+        }
+        // Number of line segments that keep a flattened curve within tolerance of the curve
+        int CurveSegments(float tolerance) const;
+    };
+
+    DisplayList() { Clear(); }
+
+    // Quantized coordinates cover range [-2, 2[, which leaves room for geometry outside of the viewport.
+    static constexpr float QuantizationScale = 16384.0f;
+
+    // Empties the list and sets the starting point. Allocated storage is retained.
+    void Clear(Point origin = Point{0});
+
+    // Selects vertex storage format. Clears the list.
+    void SetQuantized(bool quantized);
+    bool IsQuantized() const { return m_quantized; }
+    // Converts quantized vertices to floats and stores the following ones as floats. Keeps the contents.
+    void Dequantize();
+
+    // Starting point set on Clear
+    Point Origin() const { return GetVertex(0); }
+
+    void AddSync(Point p);
+    void AddLine(Point to, float intensity);
+    void AddLine(Point to, float fromIntensity, float toIntensity);
+    void AddCircle(float radius, float intensity);
+    void AddEllipse(float radius, float intensity, Point axisX, Point axisY);
+    // Curves are drawn from the current point and their end point becomes the current point
+    void AddQuadratic(Point control, Point to, float intensity);
+    void AddCubic(Point control1, Point control2, Point to, float intensity);
+    // Arcs have their own center and do not change the current point
+    void AddArc(Point center, float radius, float intensity, Point axisX, Point axisY, float start, float end);
+    // Adds a decoded circle primitive as an ellipse or an arc. Full circles are centered on the current point.
+    void AddCircle(const Primitive& p);
+    // Parametric curves are drawn from curve(start) to curve(end) with transform t applied to the curve points. Like
+    // arcs they do not change the current point.
+    void AddParametric(std::shared_ptr<const ParametricCurve> curve, float start, float end, float intensity, const Transform& t = Transform{});
+    void AddParametric(const Primitive& p);
+
+    // Sets transform of the vertices and circles added after this call. Transforms are not combined.
+    void AddTransform(const Transform& t);
+
+    // Draws an immutable shape list with transform t on top of the current transform. Intensity >= 0 overrides
+    // the intensities of the shape. Shapes start from their own origin and do not change the current point.
+    void AddInstance(std::shared_ptr<const DisplayList> shape, const Transform& t, float intensity);
+
+    // Sets layer of the commands added after this call. Commands are on layer 0 after Clear.
+    void AddLayer(int layer);
+    int Layer() const { return m_layer; }
+    // Bit mask of the layers that have been selected since Clear, bit 0 is always set
+    uint32_t Layers() const { return m_layerMask; }
+
+    // Sets transform slot of the commands added after this call, -1 for none. Slot transform is applied on top of
+    // the recorded transforms when the list is resolved or, by a device that latches slots, when it is output.
+    // Commands have no slot after Clear.
+    void AddSlot(int slot);
+    int Slot() const { return m_slot; }
+    // Bit mask of the slots that have been selected since Clear, 0 if none
+    uint32_t Slots() const { return m_slotMask; }
+
+    // Appends lines from the current point through the points
+    void AddPolyline(const Point* points, size_t count, float intensity);
+
+    // Returns an identifier for the current list content. Lists that have not been modified
+    // since the last call keep their identifier, also when copied.
+    uint64_t Seal();
+
+    // Clip primitives to the viewport before encoding
+    void SetClipping(bool clipping);
+    bool IsClipping() const { return m_clipping; }
+
+    // Writes a copy of the list with transforms applied to vertices and circles. Circles become ellipses.
+    // The device transform is applied on top of the recorded transforms but does not affect circle radius.
+    // If slot transforms are given they are applied between the two and the copy has no slots unless keepSlots is
+    // set. Without slot transforms the slots are kept.
+    void ResolveTransforms(const Transform& device, DisplayList& out, const Transform* slots = nullptr, bool keepSlots = false) const;
+
+    // Writes the commands of a single layer and transform slot to out, which has them on layer 0 without a slot.
+    // Meant for lists with resolved transforms. A sync point is added where the commands continue from a point
+    // drawn by commands that were left out.
+    void ExtractLayer(int layer, int slot, DisplayList& out) const;
+
+    // Appends the commands of another list to the current layer, starting with a sync point to its origin if needed
+    void Append(const DisplayList& other);
+
+    // Number of commands
+    size_t Size() const { return m_ops.size(); }
+    bool Empty() const { return m_ops.empty(); }
+
+    // Bytes used by the command stream
+    size_t ByteSize() const;
+
+    // Decodes commands in recording order. Instances are expanded to the primitives of their shapes.
+    class Reader
+    {
+    public:
+        // Shape reference with the transforms of the referencing list applied. Shape of a list that is read
+        // directly does not own the list.
+        struct Instance {
+            std::shared_ptr<const DisplayList> shape;
+            Transform transform;
+            float radiusScale;
+            float intensity;  // overrides intensities of the shape when >= 0
+        };
+
+        // Read state of the list of one reader. Position of a primitive of an instance refers to the position of the
+        // reader of the enclosing list.
+        struct Position {
+            static constexpr size_t None = SIZE_MAX;
+
+            const DisplayList* list;
+            size_t op, vertex, param, instance, curve;
+            Point currPoint;
+            Transform transform;
+            bool transformed;
+            float radiusScale;
+            int layer;
+            int slot;
+            Transform base;
+            float baseRadiusScale;
+            float intensity;
+            size_t outer;  // None at the top level
+        };
+
+        // Readers for expanding instances are taken from the arena if given, otherwise from the heap.
+        // The arena must not be reset while the reader is in use.
+        explicit Reader(const DisplayList& list, FrameArena* arena = nullptr);
+        // Reads the shape of an instance as it is drawn by the instance
+        explicit Reader(const Instance& instance, FrameArena* arena = nullptr);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // Starts reading list from its first command. Reader of the instances is kept for reuse.
+        void Restart(const DisplayList& list);
+
+        // Returns false when all commands have been read. Transforms are applied to the returned primitives.
+        bool Next(Primitive& p);
+
+        // Returns true and skips the instance if the next command is an instance. Lets the caller handle
+        // instances as a whole, Next expands them.
+        bool NextInstance(Instance& instance);
+
+        // Reads list to get the positions after each primitive for Seek. Index of the position after primitive i is
+        // primitives[i + 1], primitives[0] is the start of the list. Storage of the vectors is retained.
+        static void ReadPositions(const DisplayList& list, std::vector<Position>& positions, std::vector<size_t>& primitives,
+                                  FrameArena* arena = nullptr);
+        // Continues reading at positions[index] without reading the primitives before it. Positions must be read from
+        // a list that outlives the reading.
+        void Seek(const std::vector<Position>& positions, size_t index);
+
+        // Layer of the last returned primitive or instance. Layers of the instanced shapes are not used.
+        int Layer() const { return m_layer; }
+        // Transform slot of the last returned primitive or instance, -1 for none
+        int Slot() const { return m_slot; }
+
+    private:
+        void Start(const Instance& instance);
+        Point NextVertex();
+        void ReadState();
+        Instance ReadInstance();
+        // Adds the positions of this reader and of the nested readers that changed since they were last added.
+        // Returns the index of the innermost one.
+        size_t AddPosition(std::vector<Position>& positions, size_t outer);
+        // Returns the reader that continues reading at positions[index]
+        Reader* SeekLevel(const std::vector<Position>& positions, size_t index);
+
+        const DisplayList* m_list;
+        size_t m_op = 0;
+        size_t m_vertex = 0;
+        size_t m_param = 0;
+        size_t m_instance = 0;
+        size_t m_curve = 0;
+        Point m_currPoint;
+        Transform m_transform;
+        bool m_transformed = false;
+        float m_radiusScale = 1.0f;
+        int m_layer = 0;
+        int m_slot = -1;
+
+        // Instance state, transforms of the list are applied on top of the base transform
+        Transform m_base;
+        float m_baseRadiusScale = 1.0f;
+        float m_intensity = -1;
+        // Reader of the instance being expanded, reused for the following instances
+        Reader* m_nested = nullptr;
+        bool m_nestedActive = false;
+        FrameArena* m_arena;
+        size_t m_position = Position::None;  // last added by AddPosition
+
+    };
+
+private:
+    struct QPoint {
+        int16_t x;
+        int16_t y;
+    };
+
+    void AddVertex(Point p);
+    Point GetVertex(size_t idx) const;
+
+    bool m_quantized = false;
+    bool m_clipping = false;
+    int m_layer = 0;
+    uint32_t m_layerMask = 1;
+    int m_slot = -1;
+    uint32_t m_slotMask = 0;
+    uint64_t m_generation = 0;  // 0 when modified after the last Seal
+    std::vector<Op> m_ops;
+    std::vector<Point> m_vertices;
+    std::vector<QPoint> m_qvertices;
+    std::vector<float> m_params;
+    std::vector<std::shared_ptr<const DisplayList>> m_instances;
+    std::vector<std::shared_ptr<const ParametricCurve>> m_curves;
+};
+}  // namespace AudioRender
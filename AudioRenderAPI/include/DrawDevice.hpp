@@ -1,26 +1,28 @@
 #pragma once
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
-namespace AudioRender
-{
-struct Rectangle {
-    float left;
-    float top;
-    float right;
-    float bottom;
-};  // namespace Rectangle
-
-struct Point {
-    float x = 0;
-    float y = 0;
-
-    Point operator+(const Point&& p) const { return {x + p.x, y + p.y}; }
-    Point operator*(float f) const { return {x * f, y * f}; }
-};
+#include "Geometry.hpp"
+#include "DisplayList.hpp"
+#include "PathOptimizer.hpp"
+#include "Clipper.hpp"
+#include "Simplifier.hpp"
+#include "CommandBuffer.hpp"
+#include "ListRecorder.hpp"
+#include "Parametric.hpp"
 
-static inline Point operator+(const Point p1, const Point p2) { return {p1.x + p2.x, p1.y + p2.y}; }
+// Win32 maps DrawText to DrawTextA or DrawTextW
+#ifdef DrawText
+#undef DrawText
+#endif
 
+namespace AudioRender
+{
 class IDrawDevice
 {
 public:
@@ -50,12 +52,128 @@ public:
     // draw line from current point to target point. Target point becomes new current point.
     // Line intensity will lerp linearnly towards intensity, if >= 0.
     virtual void DrawLine(Point to, float intensity = -1) = 0;
+
+    // draw quadratic Bezier curve from current point to target point. Target point becomes new current point.
+    virtual void DrawQuadratic(Point control, Point to) = 0;
+
+    // draw cubic Bezier curve from current point to target point. Target point becomes new current point.
+    virtual void DrawCubic(Point control1, Point control2, Point to) = 0;
+
+    // draw arc of a circle around center. Angles are in radians, angle 0 is on the positive x axis and angles grow
+    // towards the positive y axis. Current point is not changed.
+    virtual void DrawArc(Point center, float radius, float startAngle, float endAngle) = 0;
+
+    // set first point as current point and draw lines through the rest. Closed polyline is drawn back
+    // to the first point. Equivalent to SetPoint followed by DrawLine calls, but in a single call.
+    virtual void DrawPolyline(const Point* points, size_t count, bool closed = false) = 0;
+
+    // draw parametric curve from curve(t0) to curve(t1) with the current transform. The curve is sampled when the frame
+    // is encoded, with steps that follow the beam speed and get shorter where the curve turns. Current point is not changed.
+    virtual void DrawParametric(std::shared_ptr<const ParametricCurve> curve, float t0, float t1) = 0;
+
+    // draw several polylines. Points of the paths are stored back to back and counts has the number of points in each path.
+    virtual void DrawPaths(const Point* points, const size_t* counts, size_t pathCount, bool closed = false) = 0;
+
+    // start recording a reusable shape. Primitives drawn until EndShape go to the shape instead of the frame.
+    // Shape is drawn from its own origin with identity transform and default intensity.
+    virtual void BeginShape() = 0;
+
+    // end shape recording. Returns the shape identifier for DrawInstance or -1 if no shape was started.
+    // Shapes are kept until the device is released.
+    virtual int EndShape() = 0;
+
+    // draw a recorded shape with transform t applied on top of the current transform. Intensity >= 0 overrides the
+    // intensities of the shape. Current point is not changed.
+    virtual void DrawInstance(int shape, const Transform& t, float intensity = -1) = 0;
+
+    // draw text with the built-in stroke font using the current intensity. Position is the left end of the baseline
+    // and scale is the height of capital letters. Lines are separated by '\n'. Current point is not changed.
+    virtual void DrawText(const char* text, Point position, float scale) = 0;
+
+    // set transform of points and circles drawn after this call. Transform is reset to identity on Begin.
+    virtual void SetTransform(const Transform& t) = 0;
+
+    // save current transform and combine t with it. t is applied first.
+    virtual void PushTransform(const Transform& t) = 0;
+
+    // restore transform saved by the matching PushTransform
+    virtual void PopTransform() = 0;
+
+    // set layer of primitives drawn after this call. Layers can be refreshed at different rates, see the device
+    // for configuration. Layer is reset to 0 on Begin. Shapes are drawn on the layer of the instance.
+    virtual void SetLayer(int layer) = 0;
+
+    // clip lines and circles to the viewport, so that only visible parts are rendered
+    virtual void SetClipping(bool enabled) = 0;
+
+    // tag primitives drawn after this call with a transform slot, -1 for none. The slot transform is applied on top
+    // of the current transform and can be changed with UpdateTransformSlot after the frame has been submitted.
+    // Slot is reset to -1 on Begin. Shapes are drawn with the slot of the instance.
+    virtual void SetTransformSlot(int slot) = 0;
+
+    // set transform of a slot. Can be called from any thread at any time. Devices that latch slots apply the latest
+    // transform to samples as they are handed to the output, so a moving object follows input without waiting for
+    // the queued frames to play. Other devices apply it when the next frame is submitted. Either way the frame is
+    // clipped and sampled with the transform the slot has when the frame is submitted.
+    virtual void UpdateTransformSlot(int slot, const Transform& t) = 0;
+
+    // store primitives drawn since Begin as a named display list
+    virtual void RecordList(const char* name) = 0;
+
+    // replace current drawing with a recorded display list. Returns false if there is no list with the name.
+    // Replaying an unchanged list lets the device reuse its previously encoded output.
+    virtual bool ReplayList(const char* name) = 0;
+};
+
+// Statistics of the most recently encoded frame
+struct FrameStats {
+    size_t samples = 0;         // samples per frame refresh
+    size_t listBytes = 0;       // size of the submitted display list
+    size_t samplesSaved = 0;    // samples saved by path optimization
+    float blankTravel = 0;      // beam travel between strokes in output units
+    float blankTravelSaved = 0;
+    float optimizeMs = 0;
+    size_t primitivesBefore = 0;  // primitives before and after simplification
+    size_t primitivesAfter = 0;
+    float refreshRate = 0;      // frame refreshes per second, 0 if not known
+    float detail = 1;           // segment density relative to the default
+    size_t layerSamples[DisplayList::MaxLayers] = {};     // samples of each layer when it is drawn
+    float layerRefreshRate[DisplayList::MaxLayers] = {};  // refreshes per second of each layer, 0 if empty or not known
+    size_t scratchBytes = 0;          // most frame scratch memory used by a frame
+    uint64_t scratchAllocations = 0;  // heap allocations of the frame scratch memory, constant in steady state
 };
 
 class DrawDevice : public IDrawDevice
 {
 public:
-    const float DefaultIntensity = 0.5;
+    static constexpr float DefaultIntensity = ListRecorder::DefaultIntensity;
+
+    // Store vertices with 16-bit DAC resolution instead of floats. Takes effect on next Begin.
+    // Vertices are stored before transforms and quantization covers only [-2, 2[, so a frame falls back to float
+    // vertices from its first non-identity transform or transform slot on.
+    void setVertexQuantization(bool enabled) { m_quantizeVertices = enabled; }
+
+    // Reorder and reverse strokes before encoding to minimize blank beam travel. Optimization of
+    // a frame is stopped after budgetMs. Optimized order is reused while the display list does not change.
+    void setPathOptimization(bool enabled, float budgetMs = 2.0f);
+
+    // Merge collinear lines, drop segments shorter than the tolerance and fold redundant sync points
+    // before encoding. Tolerance is in 16-bit DAC steps of the output.
+    void setSimplification(bool enabled, float tolerance = 2.0f);
+
+    // Draw layer only on every divisor-th refresh. Refreshes without the slower layers are shorter, so the other
+    // layers are refreshed more often within the same sample budget. All layers are drawn on every refresh by default.
+    void setLayerRefreshDivisor(int layer, int divisor);
+
+    FrameStats GetFrameStats();
+
+    // Appends command buffers to the frame in the order given and submits the frame. The buffers are added after
+    // the primitives drawn on the device since Begin. Buffers can be recorded by other threads, but recording must
+    // have finished. Path optimization and simplification, if enabled, run on the merged frame.
+    void SubmitCommandBuffers(const CommandBuffer* const* buffers, size_t count);
+
+    // Recorded shape for drawing with CommandBuffer::DrawInstance, nullptr if there is no such shape
+    std::shared_ptr<const DisplayList> GetShape(int shape) const;
 
     //==========================================================
     // IDrawDevice interface
@@ -64,23 +182,109 @@ public:
     void SetIntensity(float intensity) override;
     void DrawCircle(float radius) override;
     void DrawLine(Point to, float intensity = -1) override;
+    void DrawQuadratic(Point control, Point to) override;
+    void DrawCubic(Point control1, Point control2, Point to) override;
+    void DrawArc(Point center, float radius, float startAngle, float endAngle) override;
+    void DrawPolyline(const Point* points, size_t count, bool closed = false) override;
+    void DrawPaths(const Point* points, const size_t* counts, size_t pathCount, bool closed = false) override;
+    void DrawParametric(std::shared_ptr<const ParametricCurve> curve, float t0, float t1) override;
+    void BeginShape() override;
+    int EndShape() override;
+    void DrawInstance(int shape, const Transform& t, float intensity = -1) override;
+    void DrawText(const char* text, Point position, float scale) override;
+    void SetTransform(const Transform& t) override;
+    void PushTransform(const Transform& t) override;
+    void PopTransform() override;
+    void SetLayer(int layer) override;
+    void SetClipping(bool enabled) override;
+    void SetTransformSlot(int slot) override;
+    void UpdateTransformSlot(int slot, const Transform& t) override;
     Rectangle GetViewPort() override { return m_viewPort; }
+    void RecordList(const char* name) override;
+    bool ReplayList(const char* name) override;
 
 protected:
     // Graphics operations
-    struct GraphicsPrimitive {
-        enum class Type { DRAW_CIRCLE, DRAW_LINE, DRAW_SYNC };
-
-        Type type;
-        float r;
-        float intensity;
-        Point p;
-        Point toPoint;
-    };
-
-    Point m_currPoint{0};
-    float m_currIntensity = DefaultIntensity;
-    std::vector<GraphicsPrimitive> m_operations;
+    using GraphicsPrimitive = DisplayList::Primitive;
+
+    // Applies transforms and runs the enabled optimization passes on a submitted list. Returns the list to encode.
+    // Passes are run on each layer separately and the result has the layers in order.
+    // Result is reused while the list does not change, reset m_preparedGeneration to invalidate it.
+    DisplayList& PrepareFrame(DisplayList& list);
+    DisplayList& RunPasses(DisplayList& list, FrameStats& stats);
+
+    int LayerRefreshDivisor(int layer) const { return m_layerDivisors[layer] > 1 ? m_layerDivisors[layer] : 1; }
+    // Whether a layer is drawn on the refresh with the given sequence number
+    bool LayerDue(int layer, uint32_t refresh) const { return refresh % LayerRefreshDivisor(layer) == 0; }
+
+    // Scale of the output device, applied together with the drawing transforms
+    virtual Transform DeviceTransform() const { return Transform{}; }
+
+    // Devices that apply transform slots to their output return true. PrepareFrame applies the slot transforms in
+    // either case. For latching devices it keeps the slots, runs the passes on each slot separately and stores the
+    // applied transforms to m_preparedSlots, so that the output can be moved by the change from them.
+    virtual bool LatchesTransformSlots() const { return false; }
+    // Copies the current slot transforms and returns their version, which changes on every update
+    uint32_t ReadTransformSlots(Transform* slots);
+    // Latest slot transforms for the output thread, read without locking. Only the output thread may call this, the
+    // table is valid until its next call.
+    const Transform* OutputTransformSlots();
+
+    // Sample counts are per layer. Refresh rates are reported if the sample rate is known.
+    void SetFrameSampleCount(const size_t* layerSamples, float sampleRate = 0, float detail = 1.0f);
+
+    // Releases the scratch memory of the previous frame. Called by the encoders when they start on a frame, before
+    // PrepareFrame. Resetting on Begin would free memory that the encoder thread is still using in pipelined mode.
+    void ResetFrameArena();
+    FrameArena m_frameArena;
+
+    bool m_pathOptimization = false;
+    float m_pathOptimizationBudgetMs = 0;
+    PathOptimizer m_pathOptimizer;
+    DisplayList m_resolvedList;
+    DisplayList m_clippedList;
+    ParametricSampler m_clipSampler;
+    bool m_simplification = false;
+    float m_simplificationTolerance = 0;
+    Simplifier m_simplifier;
+    DisplayList m_simplifiedList;
+    DisplayList m_preparedList;
+    DisplayList m_layerList;
+    DisplayList m_layeredList;
+    DisplayList* m_preparedFrame = nullptr;
+    uint64_t m_preparedGeneration = 0;
+    uint32_t m_preparedSlotVersion = 0;
+    Transform m_preparedSlots[DisplayList::MaxTransformSlots];
+    std::mutex m_statsMutex;
+    FrameStats m_frameStats;
+
+    // Frame list, or the shape list while a shape is recorded, with its drawing state
+    ListRecorder m_recorder;
+    bool m_quantizeVertices = false;
+    bool m_clipping = false;
+    int m_layerDivisors[DisplayList::MaxLayers] = {};
+
+    // Updated by UpdateTransformSlot from any thread
+    std::mutex m_slotMutex;
+    Transform m_slotTransforms[DisplayList::MaxTransformSlots];
+    uint32_t m_slotVersion = 0;
+    // Copies of the slot transforms for the output thread, handed over through three tables like the just-in-time
+    // frames. An update fills the back table and swaps it with the published one, the output thread swaps the table
+    // it reads with the published one when there is a new one.
+    static constexpr uint32_t NewSlotsFlag = 4;
+    Transform m_slotTables[3][DisplayList::MaxTransformSlots];
+    std::atomic<uint32_t> m_slotPublished{1};  // index of the published table and NewSlotsFlag until it is taken
+    uint32_t m_slotBack = 0;                   // used by the updates under m_slotMutex
+    uint32_t m_slotFront = 2;                  // used by the output thread
+
+    std::map<std::string, DisplayList> m_recordedLists;
+
+    // Recorded shapes. Frame recorder is set aside while a shape is recorded.
+    std::vector<std::shared_ptr<const DisplayList>> m_shapes;
+    bool m_recordingShape = false;
+    ListRecorder m_frameRecorder;
+    // Shapes of the stroke font glyphs by character, -1 until the glyph is first drawn
+    std::vector<int> m_glyphShapes;
     const Rectangle m_viewPort{-0.5, -0.5, 0.5, 0.5};
 };
 }  // namespace AudioRender
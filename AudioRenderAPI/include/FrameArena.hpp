@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace AudioRender
+{
+// Bump allocator for scratch memory that lives until the end of a frame.
+//
+// Allocations are carved from a single block and released all at once by Reset. Destructors are not run,
+// objects that need one must be destroyed by their owner. When a frame needs more than the block holds,
+// overflow blocks are taken from the heap and Reset grows the block to the largest frame seen so far, so in
+// steady state a frame does not allocate from the heap.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t initialSize = 16 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* Allocate(size_t count)
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    template <typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Releases all allocations. Allocated memory is retained for the next frame.
+    void Reset();
+
+    // Bytes allocated since the last Reset and the most allocated by a single frame
+    size_t Used() const { return m_used; }
+    size_t HighWater() const { return m_highWater; }
+    size_t Capacity() const { return m_capacity; }
+
+    // Number of heap allocations made by the arena. Stays constant once frames fit the block.
+    uint64_t HeapAllocations() const { return m_heapAllocations; }
+
+private:
+    uint8_t* AllocateBlock(size_t size);
+
+    uint8_t* m_block = nullptr;
+    size_t m_capacity = 0;
+    size_t m_offset = 0;
+    // Blocks taken when the frame did not fit, freed on Reset
+    std::vector<uint8_t*> m_overflow;
+    size_t m_overflowOffset = 0;
+    size_t m_overflowSize = 0;
+    size_t m_used = 0;
+    size_t m_highWater = 0;
+    uint64_t m_heapAllocations = 0;
+};
+}  // namespace AudioRender
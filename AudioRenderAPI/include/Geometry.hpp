@@ -0,0 +1,63 @@
+#pragma once
+
+#include <math.h>
+
+namespace AudioRender
+{
+struct Rectangle {
+    float left;
+    float top;
+    float right;
+    float bottom;
+};  // namespace Rectangle
+
+struct Point {
+    float x = 0;
+    float y = 0;
+
+    Point operator+(const Point&& p) const { return {x + p.x, y + p.y}; }
+    Point operator*(float f) const { return {x * f, y * f}; }
+};
+
+static inline Point operator+(const Point p1, const Point p2) { return {p1.x + p2.x, p1.y + p2.y}; }
+
+// 2D affine transform
+// x' = a * x + c * y + tx
+// y' = b * x + d * y + ty
+struct Transform {
+    float a = 1;
+    float b = 0;
+    float c = 0;
+    float d = 1;
+    float tx = 0;
+    float ty = 0;
+
+    Point Apply(Point p) const { return {a * p.x + c * p.y + tx, b * p.x + d * p.y + ty}; }
+
+    // Transform that applies t first and then this
+    Transform operator*(const Transform& t) const
+    {
+        return {a * t.a + c * t.b, b * t.a + d * t.b, a * t.c + c * t.d, b * t.c + d * t.d, a * t.tx + c * t.ty + tx, b * t.tx + d * t.ty + ty};
+    }
+
+    bool IsIdentity() const { return a == 1 && b == 0 && c == 0 && d == 1 && tx == 0 && ty == 0; }
+
+    // Area scale of the transform
+    float Determinant() const { return a * d - b * c; }
+
+    // Transform that undoes this one, identity if there is none
+    Transform Inverse() const
+    {
+        const float det = Determinant();
+        if (det == 0) return {};
+        const Transform r{d / det, -b / det, -c / det, a / det, 0, 0};
+        return {r.a, r.b, r.c, r.d, -(r.a * tx + r.c * ty), -(r.b * tx + r.d * ty)};
+    }
+
+    static Transform Translate(float x, float y) { return {1, 0, 0, 1, x, y}; }
+    static Transform Scale(float sx, float sy) { return {sx, 0, 0, sy, 0, 0}; }
+    static Transform Scale(float s) { return Scale(s, s); }
+    // counterclockwise rotation
+    static Transform Rotate(float rad) { return {cosf(rad), sinf(rad), -sinf(rad), cosf(rad), 0, 0}; }
+};
+}  // namespace AudioRender
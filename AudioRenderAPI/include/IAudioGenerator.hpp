@@ -12,4 +12,19 @@ public:
 
     virtual HRESULT Initialize(UINT32 FramesPerPeriod, WAVEFORMATEX* wfx) = 0;
     virtual HRESULT FillSampleBuffer(UINT32 BytesToRead, BYTE* Data) = 0;
+
+    // Writes samples straight to the output memory, for example a buffer of the audio device, and returns the number
+    // of bytes written. Generators that can produce any length write the whole span. The default fills whole buffers
+    // of GetBufferLength with FillSampleBuffer and leaves the rest.
+    virtual HRESULT ProduceSamples(UINT32 BytesAvailable, BYTE* Data, UINT32* BytesWritten)
+    {
+        *BytesWritten = 0;
+        const UINT32 length = GetBufferLength();
+        if (length == 0) return S_OK;
+        for (; *BytesWritten + length <= BytesAvailable; *BytesWritten += length) {
+            const HRESULT hr = FillSampleBuffer(length, Data + *BytesWritten);
+            if (FAILED(hr)) return hr;
+        }
+        return S_OK;
+    }
 };
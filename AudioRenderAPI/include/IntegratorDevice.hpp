@@ -19,8 +19,10 @@ public:
     void setScale(float xscale, float yscale);
 
 protected:
+    Transform DeviceTransform() const override { return Transform::Scale(m_xScale, m_yScale); }
+
     // Graphics encoding to samples
-    void EncodeSamples(const std::vector<GraphicsPrimitive>& ops);
+    void EncodeSamples(const DisplayList& list);
     struct EncodeCtx {
         bool syncPoint;
         float xref;
@@ -29,9 +31,17 @@ protected:
     int encodeSync(float x, float y, EncodeCtx& ctx);
     int EncodeCircle(const GraphicsPrimitive& p, EncodeCtx& ctx);
     int EncodeLine(const GraphicsPrimitive& p, EncodeCtx& ctx);
+    int EncodeCurve(const GraphicsPrimitive& p, EncodeCtx& ctx);
+    int EncodeParametric(const GraphicsPrimitive& p, EncodeCtx& ctx);
     int EncodeSync(const GraphicsPrimitive& p, EncodeCtx& ctx);
 
+    // Samples of the last encoded frame. Reused as long as the display list does not change.
     std::vector<FTSample> m_samples;
+    uint64_t m_samplesGeneration = 0;
+    // Layers are stored back to back, samples of layer n are between offsets n and n + 1
+    size_t m_layerOffsets[DisplayList::MaxLayers + 1] = {};
+
+    ParametricSampler m_parametricSampler;
 
     // Amplitude scale
     float m_xScale;
@@ -72,6 +82,10 @@ protected:
 
     int m_frameDurationMs = 10;
 
+    // Samples sent on the current refresh
+    std::vector<FTSample> m_frameSamples;
+    uint32_t m_refreshCount = 0;
+
     void clearError();
     void updateError(const char* str, DWORD err);
     DWORD m_lastError;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "DisplayList.hpp"
+
+namespace AudioRender
+{
+// Records drawing commands to a display list. Keeps the drawing state of the recording: current transform, transform
+// stack and intensity. Used by DrawDevice for its frames and shapes and by CommandBuffer, so that a primitive is
+// recorded the same way wherever it is drawn. Drawing functions work like their IDrawDevice counterparts.
+class ListRecorder
+{
+public:
+    static constexpr float DefaultIntensity = 0.5f;
+
+    // Clears the list and starts from the origin on layer 0 without a transform slot, with identity transform and
+    // default intensity. Storage is retained.
+    void Reset();
+
+    void SetPoint(Point p);
+    void SetIntensity(float intensity) { m_currIntensity = intensity; }
+    float Intensity() const { return m_currIntensity; }
+    void DrawCircle(float radius);
+    void DrawLine(Point to, float intensity = -1);
+    void DrawQuadratic(Point control, Point to);
+    void DrawCubic(Point control1, Point control2, Point to);
+    void DrawArc(Point center, float radius, float startAngle, float endAngle);
+    void DrawPolyline(const Point* points, size_t count, bool closed = false);
+    void DrawPaths(const Point* points, const size_t* counts, size_t pathCount, bool closed = false);
+    void DrawParametric(std::shared_ptr<const ParametricCurve> curve, float t0, float t1);
+    void DrawInstance(std::shared_ptr<const DisplayList> shape, const Transform& t, float intensity = -1);
+    void SetTransform(const Transform& t);
+    void PushTransform(const Transform& t);
+    void PopTransform();
+    void SetLayer(int layer) { m_list.AddLayer(layer); }
+    void SetTransformSlot(int slot);
+
+    // Recorded to the list before the next primitive when changed
+    void FlushTransform();
+    // Records the current transform before the next primitive, for lists that got commands from elsewhere
+    void InvalidateTransform() { m_transformChanged = true; }
+
+    DisplayList& List() { return m_list; }
+    const DisplayList& List() const { return m_list; }
+
+private:
+    DisplayList m_list;
+    Transform m_transform;
+    std::vector<Transform> m_transformStack;
+    bool m_transformChanged = false;
+    float m_currIntensity = DefaultIntensity;
+};
+}  // namespace AudioRender
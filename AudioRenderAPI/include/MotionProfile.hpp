@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace AudioRender
+{
+// Places samples along connected lines by the motion of the beam, used by the motion profile mode of the encoder.
+//
+// Speed follows a trapezoidal profile on each line. The beam accelerates at a limited rate from the speed it enters
+// the line with, cruises at the speed of the line and slows down in time to reach the end at the corner speed.
+// Cruise speed is interpolated between the speeds of the line ends, which follow its intensity ramp. Corner speed
+// falls with the turn to zero at right angles, and sharp corners get extra samples on the corner point. Output
+// filters of sound cards round off fast changes in the signal, so samples are packed where the beam turns instead
+// of everywhere.
+//
+// A line is planned when the line after it is known. Distances and speeds are measured with the coordinates divided
+// by the device scale, speeds are in distance per sample.
+class MotionProfile
+{
+public:
+    struct Line {
+        Point from;
+        Point to;
+        float fromSpeed;  // cruise speed at the ends
+        float toSpeed;
+    };
+
+    // Line waiting for the one after it
+    struct State {
+        bool pending = false;
+        Line line;
+        int slot = -1;  // transform slot of the pending line
+        float entrySpeed = 0;
+    };
+
+    // Starts line. The pending line is planned to end at the corner to it, or at rest if it does not continue
+    // from the end of the pending line. Returns the number of points of the pending line.
+    size_t Add(State& state, const Line& line, int slot, Point scale);
+
+    // Plans the pending line to end at rest. Returns the number of points.
+    size_t Finish(State& state, Point scale);
+
+    // Points of the last planned line after its start point, followed by the samples on the corner
+    const Point* Points() const { return m_points.data(); }
+
+private:
+    size_t Plan(State& state, const Line* next, Point scale);
+
+    // Scratch storage, retained between frames
+    std::vector<Point> m_points;
+};
+}  // namespace AudioRender
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "DisplayList.hpp"
+
+namespace AudioRender
+{
+// Curve given as a function of parameter t, drawn with IDrawDevice::DrawParametric.
+//
+// Curves are evaluated when the frame is encoded, which can be on the encoder thread, so a curve must not change
+// once it has been drawn. Built-in families evaluate four parameters at a time with SSE2 when it is available.
+class ParametricCurve : public std::enable_shared_from_this<ParametricCurve>
+{
+public:
+    virtual ~ParametricCurve() = default;
+
+    // Writes the curve points at parameters t
+    virtual void Evaluate(const float* t, Point* points, size_t count) const = 0;
+
+    // Number of even intervals [t0, t1] is divided to before adaptive refinement. Intervals must be short enough
+    // that no loop of the curve fits within one.
+    virtual int Segments(float t0, float t1) const { return 64; }
+
+    struct Sinusoid {
+        float amplitude;
+        float frequency;  // radians per unit of t
+        float phase;
+    };
+
+    // x(t) and y(t) are sums of amplitude * sin(frequency * t + phase) over their terms
+    static std::shared_ptr<const ParametricCurve> Sinusoids(const Sinusoid* x, size_t xCount, const Sinusoid* y, size_t yCount);
+
+    // Lissajous figure x = ax * sin(fx * t + phase), y = ay * sin(fy * t). Closed over [0, 2 pi] for integer frequencies.
+    static std::shared_ptr<const ParametricCurve> Lissajous(float ax, float fx, float ay, float fy, float phase);
+
+    // Polar curve at angle t with radius r0 + growth * t plus the sum of amplitude * sin(frequency * t + phase) over
+    // the terms. Covers Archimedean spirals, roses and limaçons.
+    static std::shared_ptr<const ParametricCurve> Polar(float r0, float growth, const Sinusoid* terms = nullptr, size_t count = 0);
+
+    // Curve from a callback, for example f(t) = {t, y(t)} for a function plot. Evaluated one point at a time.
+    static std::shared_ptr<const ParametricCurve> Function(std::function<Point(float)> f, int segments = 64);
+};
+
+// Flattens parametric curve primitives to points for the encoders.
+//
+// The parameter range is first divided evenly and intervals whose middle point is further than the tolerance from
+// the chord are split until the polyline follows the curve. Sample then walks the polyline at the beam speed of
+// lines, with shorter steps where the polyline turns so that the straight beam path between samples stays within
+// tolerance as well.
+class ParametricSampler
+{
+public:
+    // Points of the curve within tolerance, including both end points. Returns the number of points.
+    size_t Flatten(const DisplayList::Primitive& p, float tolerance);
+
+    // Points along the curve at most spacing apart. Distances, including the tolerance, are measured with the
+    // coordinates divided by scale. Returns the number of points, the first and last ones are the end points.
+    size_t Sample(const DisplayList::Primitive& p, float spacing, float tolerance, Point scale = Point{1, 1});
+
+    const Point* Points() const { return m_points.data(); }
+
+private:
+    void EvaluateTransformed(const DisplayList::Primitive& p, const float* t, Point* points, size_t count) const;
+    // Flattens the curve to m_line
+    void Refine(const DisplayList::Primitive& p, float tolerance, Point scale);
+
+    // Scratch storage, retained between frames
+    std::vector<float> m_t;
+    std::vector<Point> m_line;
+    std::vector<uint8_t> m_open;  // per interval, 1 while it may need splitting
+    std::vector<float> m_splitT;
+    std::vector<Point> m_split;
+    std::vector<float> m_nextT;
+    std::vector<Point> m_nextLine;
+    std::vector<uint8_t> m_nextOpen;
+    std::vector<float> m_steps;  // length of each interval of m_line in sample steps
+    std::vector<Point> m_points;
+};
+}  // namespace AudioRender
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "DisplayList.hpp"
+
+namespace AudioRender
+{
+// Reorders the strokes of a display list to minimize blank beam travel between them.
+//
+// The list is split into strokes at sync points. Stroke order is first built with a nearest
+// neighbour search and then refined with 2-opt moves. Strokes can be drawn in reverse direction
+// and a stroke that starts where the previous one ended is joined to it without a sync point.
+// Drawing is not affected as the display has no notion of draw order.
+class PathOptimizer
+{
+public:
+    struct Stats {
+        size_t strokes = 0;
+        size_t joined = 0;        // strokes drawn without a sync point
+        size_t samplesSaved = 0;  // samples of the removed sync points and of the line starts after them
+        float travelBefore = 0;   // blank travel in submission order
+        float travelAfter = 0;    // blank travel in optimized order
+        float elapsedMs = 0;
+    };
+
+    // Writes optimized version of list to out. When the time budget runs out the remaining
+    // strokes are placed in their submission order. Scratch memory is taken from the arena if given.
+    Stats Optimize(const DisplayList& list, DisplayList& out, float budgetMs, FrameArena* arena = nullptr);
+
+private:
+    struct Stroke {
+        size_t first;  // primitive range
+        size_t last;
+        Point start;
+        Point end;
+        bool leading;  // drawn from the list origin without a sync point
+        bool arc;      // beam does not stop on the end point after an arc or a parametric curve
+        bool path;     // has lines or curves, the first one after a sync point adds a sample on its start point
+    };
+
+    struct Visit {
+        size_t stroke;
+        bool reversed;
+    };
+
+    Point StartOf(const Visit& v) const { return v.reversed ? m_strokes[v.stroke].end : m_strokes[v.stroke].start; }
+    Point EndOf(const Visit& v) const { return v.reversed ? m_strokes[v.stroke].start : m_strokes[v.stroke].end; }
+    Point EndBefore(size_t idx) const { return idx ? EndOf(m_order[idx - 1]) : m_origin; }
+
+    // Returns the samples of the sync points of the list
+    size_t SplitStrokes(const DisplayList& list, FrameArena* arena);
+    void NearestNeighbour(double deadline);
+    void TwoOpt(double deadline);
+    float Travel() const;
+    // Returns the strokes joined and the samples of the sync points written
+    size_t Emit(DisplayList& out, size_t& syncSamples) const;
+
+    // Scratch storage, retained between frames
+    std::vector<DisplayList::Primitive> m_primitives;
+    std::vector<Stroke> m_strokes;
+    std::vector<Visit> m_order;
+    std::vector<bool> m_visited;
+    Point m_origin;
+};
+}  // namespace AudioRender
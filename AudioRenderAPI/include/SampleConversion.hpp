@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace AudioRender
+{
+// Converts runs of coordinates to interleaved stereo frames of the output formats.
+//
+// Coordinates are planar, x and y in arrays of their own, and each point becomes one frame with x on the left
+// channel. PCM values are the coordinate times the largest positive sample value, clamped to the range of the
+// format and rounded half away from zero. 24-bit samples are packed to three bytes. Runs are converted four points
+// at a time with SSE2 or NEON when available, and the scalar versions, which handle the remainders, give identical
+// output.
+namespace SampleConversion
+{
+using Converter = void (*)(const float* x, const float* y, size_t count, uint8_t* out);
+
+void ToPCM16(const float* x, const float* y, size_t count, uint8_t* out);
+void ToPCM24(const float* x, const float* y, size_t count, uint8_t* out);
+void ToFloat(const float* x, const float* y, size_t count, uint8_t* out);
+
+// Scalar versions, one frame at a time
+void ToPCM16Scalar(const float* x, const float* y, size_t count, uint8_t* out);
+void ToPCM24Scalar(const float* x, const float* y, size_t count, uint8_t* out);
+void ToFloatScalar(const float* x, const float* y, size_t count, uint8_t* out);
+}  // namespace SampleConversion
+}  // namespace AudioRender
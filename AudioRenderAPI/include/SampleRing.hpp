@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+namespace AudioRender
+{
+// Single producer, single consumer queue of fixed size sample buffers.
+//
+// Buffers are slots of one preallocated block. Slots start on cache lines and the two indices are on cache lines
+// of their own, so the producer and the consumer do not write to the same lines. The producer fills the slot
+// returned by Back in place and publishes it with Push, the consumer reads Front and hands the slot back with Pop.
+// Indices are stored with release and loaded with acquire ordering, nothing is locked.
+class SampleRing
+{
+public:
+    static constexpr size_t CacheLine = 64;
+
+    SampleRing() = default;
+    ~SampleRing();
+
+    SampleRing(const SampleRing&) = delete;
+    SampleRing& operator=(const SampleRing&) = delete;
+
+    // Allocates count slots of size bytes and empties the ring. Neither side may be using the ring.
+    void Allocate(size_t size, size_t count);
+
+    size_t SlotSize() const { return m_slotSize; }
+    size_t Capacity() const { return m_count; }
+
+    // Producer: slot to fill next, nullptr if the ring is full. Slot stays the same until it is pushed.
+    uint8_t* Back();
+    // Index of the Back slot, for data kept alongside the slots
+    size_t BackIndex() const { return m_write.load(std::memory_order_relaxed) % m_count; }
+    void Push();
+
+    // Consumer: oldest published slot, nullptr if the ring is empty
+    const uint8_t* Front();
+    size_t FrontIndex() const { return m_read.load(std::memory_order_relaxed) % m_count; }
+    void Pop();
+    // Drops all published slots
+    void Discard();
+
+    // Number of published slots. Can be called from either side.
+    size_t Size() const;
+
+private:
+    uint8_t* m_slab = nullptr;
+    size_t m_slotSize = 0;
+    size_t m_stride = 0;
+    size_t m_count = 1;
+
+    // Written by the producer. Read index is cached to avoid loading the consumer line on every slot.
+    alignas(CacheLine) std::atomic<size_t> m_write{0};
+    size_t m_readCache = 0;
+    // Written by the consumer
+    alignas(CacheLine) std::atomic<size_t> m_read{0};
+    size_t m_writeCache = 0;
+};
+}  // namespace AudioRender
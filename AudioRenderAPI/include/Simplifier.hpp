@@ -0,0 +1,38 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "DisplayList.hpp"
+
+namespace AudioRender
+{
+// Removes primitives that do not change the drawing but cost samples.
+//
+// Runs of lines with the same intensity are simplified with Douglas-Peucker, so collinear and
+// nearly collinear points within the tolerance are merged and zero length segments are dropped. Consecutive sync points are folded to the last one and a sync point to where the
+// beam already is after a line is removed. Curves are kept as they are.
+class Simplifier
+{
+public:
+    struct Stats {
+        size_t primitivesBefore = 0;
+        size_t primitivesAfter = 0;
+    };
+
+    // Writes simplified version of list to out. Tolerance is the largest distance in output units
+    // that a simplified line may deviate from the original. Scratch memory is taken from the arena if given.
+    Stats Simplify(const DisplayList& list, DisplayList& out, float tolerance, FrameArena* arena = nullptr);
+
+private:
+    void FlushRun(DisplayList& out, float tolerance);
+
+    // Points of the current run of lines, starting from the point the run is drawn from
+    std::vector<Point> m_run;
+    float m_runIntensity = 0;
+
+    // Scratch storage, retained between frames
+    std::vector<bool> m_keep;
+    std::vector<std::pair<size_t, size_t>> m_ranges;
+};
+}  // namespace AudioRender
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "DisplayList.hpp"
+
+namespace AudioRender
+{
+// Built-in single stroke font used by DrawText.
+//
+// Glyphs cover printable ASCII and are drawn on a grid in font units: capital letters are CapHeight units
+// tall above the baseline, y grows downwards and descenders go below the baseline. The font is monospaced.
+namespace StrokeFont
+{
+constexpr int CapHeight = 6;
+constexpr int Advance = 6;      // distance between glyph origins
+constexpr int LineHeight = 10;  // distance between baselines
+
+// Appends the strokes of a character to list, each starting with a sync point. Origin of the glyph is the left
+// end of its baseline. Characters without a glyph are drawn as '?', space has no strokes.
+void AddGlyph(char c, float intensity, DisplayList& list);
+
+// Size of the text in font units, lines are separated by '\n'
+float TextWidth(const char* text);
+float TextHeight(const char* text);
+}  // namespace StrokeFont
+}  // namespace AudioRender
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Geometry.hpp"
+
+namespace AudioRender
+{
+class IDrawDevice;
+
+// Line mesh for WireframeRenderer.
+//
+// Edges are index pairs into the vertex buffer. Triangles are optional and only used for culling: they hide the
+// edges behind them and an edge is back facing when all of its triangles are. Triangles are counterclockwise
+// when seen from the front.
+struct LineMesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> edges;      // two indices per edge
+    std::vector<uint32_t> triangles;  // three indices per triangle
+    // Two triangles per edge, -1 if there is none. Built by UpdateAdjacency.
+    std::vector<int32_t> edgeTriangles;
+
+    uint32_t AddVertex(glm::vec3 v)
+    {
+        vertices.push_back(v);
+        return uint32_t(vertices.size() - 1);
+    }
+    void AddEdge(uint32_t v0, uint32_t v1) { edges.insert(edges.end(), {v0, v1}); }
+    void AddTriangle(uint32_t v0, uint32_t v1, uint32_t v2) { triangles.insert(triangles.end(), {v0, v1, v2}); }
+
+    // Finds the triangles that share each edge. Call after the edges or triangles have changed, back face culling
+    // treats all edges as front facing until then.
+    void UpdateAdjacency();
+
+    size_t EdgeCount() const { return edges.size() / 2; }
+    size_t TriangleCount() const { return triangles.size() / 3; }
+};
+
+// Projects line meshes to 2D paths for a draw device.
+//
+// Vertices are transformed to clip space in one batch, edges are clipped to the view frustum in homogeneous
+// coordinates and mapped to the viewport of the draw device with y growing downwards. Edges that continue from
+// where the previous edge ended are joined into one path, so a mesh is drawn with a single DrawPaths call.
+// Projection uses OpenGL conventions, for example matrices from glm::perspective and glm::lookAt.
+class WireframeRenderer
+{
+public:
+    struct Stats {
+        size_t edges = 0;
+        size_t backFacing = 0;  // edges culled as back facing
+        size_t clipped = 0;     // edges completely outside of the frustum
+        size_t hidden = 0;      // edges hidden completely by triangles
+        size_t paths = 0;
+        float elapsedMs = 0;
+    };
+
+    void SetModel(const glm::mat4& model) { m_model = model; }
+    void SetView(const glm::mat4& view) { m_view = view; }
+    void SetProjection(const glm::mat4& projection) { m_projection = projection; }
+
+    // Leave out edges whose triangles all face away from the camera
+    void SetBackFaceCulling(bool enabled) { m_backFaceCulling = enabled; }
+
+    // Leave out parts of edges that are behind triangles. Triangles are rasterized to a depth buffer of
+    // resolution x resolution pixels and edges are tested against it in steps of a pixel.
+    void SetHiddenLineRemoval(bool enabled, int resolution = 256);
+
+    // Projects the edges of mesh to paths, which are kept until the next call
+    Stats Project(const LineMesh& mesh);
+
+    // Projects the mesh and draws the paths on device
+    Stats Draw(const LineMesh& mesh, IDrawDevice& device);
+
+    // Points of the projected paths back to back, PathCounts has the number of points in each path
+    const Point* Points() const { return m_points.data(); }
+    const size_t* PathCounts() const { return m_counts.data(); }
+    size_t PathCount() const { return m_counts.size(); }
+
+private:
+    void UpdateFacing(const LineMesh& mesh);
+    void RasterizeDepth(const LineMesh& mesh, bool frontOnly);
+    // Depth test at depth buffer coordinates, inverse w is larger for closer points
+    bool Visible(float x, float y, float invW) const;
+    void AddSegment(Point p0, Point p1);
+    // Adds the parts of a clipped edge that pass the depth test. Returns false if the edge is hidden.
+    bool AddVisibleParts(const glm::vec4& c0, const glm::vec4& c1);
+
+    glm::mat4 m_model{1.0f};
+    glm::mat4 m_view{1.0f};
+    glm::mat4 m_projection{1.0f};
+    bool m_backFaceCulling = false;
+    bool m_hiddenLineRemoval = false;
+    int m_depthResolution = 256;
+
+    // Scratch storage, retained between frames
+    std::vector<glm::vec4> m_clip;        // vertices in clip space
+    std::vector<uint8_t> m_frontFacing;   // per triangle
+    std::vector<float> m_depth;           // inverse w of the closest triangle per pixel
+    std::vector<Point> m_points;
+    std::vector<size_t> m_counts;
+};
+}  // namespace AudioRender
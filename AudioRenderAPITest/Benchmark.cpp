@@ -0,0 +1,1843 @@
+#include <Windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <Log.hpp>
+#include <AudioGraphics.hpp>
+#include <SampleConversion.hpp>
+#include <SampleRing.hpp>
+#include <SVGImage.hpp>
+#include <Wireframe.hpp>
+
+#include "Benchmark.hpp"
+
+// Heap allocations of all threads are counted while enabled
+static std::atomic<bool> s_countAllocations = false;
+static std::atomic<uint64_t> s_allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (s_countAllocations) s_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace
+{
+using Clock = std::chrono::high_resolution_clock;
+
+const UINT32 FramesPerPeriod = 480;  // 10ms at 48kHz
+const int BenchmarkFrames = 300;
+
+WAVEFORMATEX makeFormat(WORD bitsPerSample, bool isFloat)
+{
+    WAVEFORMATEX wfx{0};
+    wfx.wFormatTag = isFloat ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+    wfx.nChannels = 2;
+    wfx.nSamplesPerSec = 48000;
+    wfx.wBitsPerSample = bitsPerSample;
+    wfx.nBlockAlign = wfx.nChannels * bitsPerSample / 8;
+    wfx.nAvgBytesPerSec = wfx.nSamplesPerSec * wfx.nBlockAlign;
+    return wfx;
+}
+
+// Output bytes of the generator read in buffers of its own size, or in spans of the given number of frames
+std::vector<BYTE> readOutput(IAudioGenerator* generator, UINT32 blockAlign, UINT32 spanFrames, size_t size)
+{
+    std::vector<BYTE> output(size);
+    for (size_t offset = 0; offset < size;) {
+        if (spanFrames) {
+            UINT32 written = 0;
+            generator->ProduceSamples(UINT32(std::min<size_t>(spanFrames * blockAlign, size - offset)), output.data() + offset, &written);
+            offset += written;
+        } else {
+            generator->FillSampleBuffer(generator->GetBufferLength(), output.data() + offset);
+            offset += generator->GetBufferLength();
+        }
+    }
+    return output;
+}
+
+// Pulls buffers from the generator as fast as it produces them. With a span size the consumer asks the generator to
+// produce spans of that many bytes like a device with that much space free, otherwise buffers of the generator size.
+class HeadlessConsumer
+{
+public:
+    HeadlessConsumer(IAudioGenerator* generator, UINT32 spanBytes = 0)
+        : m_generator(generator)
+        , m_running(true)
+    {
+        m_thread = std::thread([this, spanBytes] {
+            std::vector<BYTE> buffer(spanBytes ? spanBytes : m_generator->GetBufferLength());
+            while (m_running) {
+                auto start = Clock::now();
+                UINT32 written = UINT32(buffer.size());
+                if (spanBytes) {
+                    m_generator->ProduceSamples(UINT32(buffer.size()), buffer.data(), &written);
+                } else {
+                    m_generator->FillSampleBuffer(UINT32(buffer.size()), buffer.data());
+                }
+                m_busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                m_bytes += written;
+                m_buffers++;
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    ~HeadlessConsumer()
+    {
+        m_running = false;
+        m_thread.join();
+    }
+
+    uint64_t buffers() const { return m_buffers; }
+    // Time spent in the generator per byte received
+    double nsPerByte() const { return m_bytes ? double(m_busyNs) / m_bytes : 0; }
+
+private:
+    IAudioGenerator* m_generator;
+    std::atomic_bool m_running;
+    std::atomic<uint64_t> m_buffers = 0;
+    std::atomic<uint64_t> m_busyNs = 0;
+    std::atomic<uint64_t> m_bytes = 0;
+    std::thread m_thread;
+};
+
+// Rotating circles and a wavy ring
+void drawRings(AudioRender::IDrawDevice* device, int frame)
+{
+    const float pi = 3.14159f;
+    const float rot = frame * pi / 180;
+
+    device->SetIntensity(0.3f);
+    for (int i = 0; i < 40; i++) {
+        const float a = rot + i * 2 * pi / 40;
+        device->SetPoint({0.35f * sinf(a), 0.35f * cosf(a)});
+        device->DrawCircle(0.05f + 0.002f * (i % 10));
+    }
+    device->SetIntensity(0.2f);
+    for (int i = 0; i < 2000; i++) {
+        const float a = rot + i * 2 * pi / 2000;
+        const float r = 0.2f + 0.05f * sinf(i * 0.1f);
+        const AudioRender::Point p{r * sinf(a), r * cosf(a)};
+        if (i % 50 == 0) {
+            device->SetPoint(p);
+        } else {
+            device->DrawLine(p);
+        }
+    }
+}
+
+// Scene that changes on every frame so that encoded output can not be reused
+void drawScene(AudioRender::IDrawDevice* device, int frame)
+{
+    device->Begin();
+    drawRings(device, frame);
+}
+
+struct FrameTimes {
+    double avgMs = 0;
+    double maxMs = 0;
+};
+
+// Measures application side cost of building and submitting frames
+FrameTimes measureFrames(AudioRender::AudioGraphicsBuilder& builder)
+{
+    FrameTimes times;
+    for (int frame = 0; frame < BenchmarkFrames; frame++) {
+        if (!builder.WaitSync(1000)) {
+            LOGE("WaitSync timeout");
+            break;
+        }
+        auto start = Clock::now();
+        drawScene(&builder, frame);
+        builder.Submit();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        times.avgMs += ms;
+        times.maxMs = std::max(times.maxMs, ms);
+    }
+    times.avgMs /= BenchmarkFrames;
+    return times;
+}
+
+void benchmarkPipeline()
+{
+    LOG("Application frame time with synchronous and pipelined Submit, %d frames", BenchmarkFrames);
+
+    for (bool pipelined : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->setPipelined(pipelined);
+
+        FrameTimes times;
+        {
+            HeadlessConsumer consumer(builder.get());
+            times = measureFrames(*builder);
+            builder->setPipelined(false);
+        }
+        LOG("%-12s frame avg %7.3f ms  max %7.3f ms", pipelined ? "pipelined" : "synchronous", times.avgMs, times.maxMs);
+    }
+}
+// Scanlines that are all drawn left to right, like an image without serpentine scan
+void drawScanlines(AudioRender::IDrawDevice* device, int frame)
+{
+    device->Begin();
+    for (int i = 0; i < 200; i++) {
+        const float y = -0.45f + i * 0.0045f;
+        const float x0 = -0.4f + 0.1f * sinf(i * 0.05f + frame);
+        device->SetPoint({x0, y});
+        device->DrawLine({x0 + 0.6f, y});
+    }
+}
+
+// Short connected segments submitted in scrambled order
+void drawScrambledPath(AudioRender::IDrawDevice* device, int frame)
+{
+    const float pi = 3.14159f;
+    const int count = 500;
+    device->Begin();
+    for (int i = 0; i < count; i++) {
+        const int k = (i * 7919 + frame) % count;
+        const float a0 = k * 2 * pi / count;
+        const float a1 = (k + 1) * 2 * pi / count;
+        const float r0 = 0.3f + 0.1f * sinf(a0 * 5);
+        const float r1 = 0.3f + 0.1f * sinf(a1 * 5);
+        device->SetPoint({r0 * sinf(a0), r0 * cosf(a0)});
+        device->DrawLine({r1 * sinf(a1), r1 * cosf(a1)});
+    }
+}
+
+void benchmarkOptimizer()
+{
+    struct Scene {
+        const char* name;
+        void (*draw)(AudioRender::IDrawDevice*, int);
+    };
+    const Scene scenes[] = {{"scanlines", drawScanlines}, {"scrambled", drawScrambledPath}};
+
+    for (const Scene& scene : scenes) {
+        for (bool optimize : {false, true}) {
+            auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+            WAVEFORMATEX wfx = makeFormat(16, false);
+            builder->Initialize(FramesPerPeriod, &wfx);
+            builder->setPathOptimization(optimize);
+
+            HeadlessConsumer consumer(builder.get());
+            double optimizeMs = 0;
+            size_t samples = 0;
+            size_t saved = 0;
+            float travelSaved = 0;
+            const int frames = 20;
+            for (int frame = 0; frame < frames; frame++) {
+                builder->WaitSync(1000);
+                scene.draw(builder.get(), frame);
+                builder->Submit();
+                auto stats = builder->GetFrameStats();
+                optimizeMs += stats.optimizeMs;
+                samples += stats.samples;
+                saved += stats.samplesSaved;
+                travelSaved += stats.blankTravelSaved;
+            }
+            LOG("%-10s %-9s samples/frame %6zu  saved %5zu  blank travel saved %7.2f  optimize %6.3f ms", scene.name,
+                optimize ? "optimized" : "original", samples / frames, saved / frames, travelSaved / frames, optimizeMs / frames);
+        }
+    }
+}
+
+void benchmarkClipping()
+{
+    for (bool clipping : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->SetClipping(clipping);
+
+        HeadlessConsumer consumer(builder.get());
+        size_t samples = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            // zoomed in on one side of the scene, most of the geometry is outside of the viewport
+            builder->Begin();
+            builder->PushTransform(AudioRender::Transform::Scale(4) * AudioRender::Transform::Translate(-0.3f, 0));
+            drawRings(builder.get(), frame);
+            builder->PopTransform();
+            builder->Submit();
+            builder->WaitSync(1000);
+            samples += builder->GetFrameStats().samples;
+        }
+        LOG("%-9s samples/frame %6zu", clipping ? "clipped" : "unclipped", samples / frames);
+    }
+}
+
+// Many copies of the rotating scene, far too much for one frame at 60Hz
+void drawHeavyScene(AudioRender::IDrawDevice* device, int frame)
+{
+    device->Begin();
+    for (int i = 0; i < 6; i++) {
+        device->PushTransform(AudioRender::Transform::Scale(1.0f + 0.2f * i));
+        drawRings(device, frame + 10 * i);
+        device->PopTransform();
+    }
+}
+
+// Single circle that refreshes far faster than needed
+void drawLightScene(AudioRender::IDrawDevice* device, int frame)
+{
+    device->Begin();
+    device->SetPoint({0.1f * sinf(frame * 0.1f), 0});
+    device->DrawCircle(0.3f);
+}
+
+void benchmarkLevelOfDetail()
+{
+    struct Scene {
+        const char* name;
+        void (*draw)(AudioRender::IDrawDevice*, int);
+    };
+    const Scene scenes[] = {{"light", drawLightScene}, {"scanlines", drawScanlines}, {"rings", drawScene}, {"heavy", drawHeavyScene}};
+
+    for (const Scene& scene : scenes) {
+        for (float hz : {0.0f, 60.0f}) {
+            auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+            WAVEFORMATEX wfx = makeFormat(16, false);
+            builder->Initialize(FramesPerPeriod, &wfx);
+            builder->setTargetRefreshRate(hz);
+
+            HeadlessConsumer consumer(builder.get());
+            AudioRender::FrameStats stats;
+            const int frames = 20;
+            for (int frame = 0; frame < frames; frame++) {
+                builder->WaitSync(1000);
+                scene.draw(builder.get(), frame);
+                builder->Submit();
+                stats = builder->GetFrameStats();
+            }
+            LOG("%-9s target %4.0f Hz  samples/frame %6zu  refresh %7.1f Hz  detail %5.2f", scene.name, hz, stats.samples, stats.refreshRate,
+                stats.detail);
+        }
+    }
+}
+
+// Connected path drawn one segment at a time, every segment starts with its own sync point
+void drawSegmentedPath(AudioRender::IDrawDevice* device, int frame)
+{
+    const float pi = 3.14159f;
+    const int count = 500;
+    device->Begin();
+    for (int i = 0; i < count; i++) {
+        const float a0 = frame * 0.01f + i * 2 * pi / count;
+        const float a1 = frame * 0.01f + (i + 1) * 2 * pi / count;
+        device->SetPoint({0.4f * sinf(a0), 0.4f * cosf(a0)});
+        device->DrawLine({0.4f * sinf(a1), 0.4f * cosf(a1)});
+    }
+}
+
+void benchmarkSimplification()
+{
+    struct Scene {
+        const char* name;
+        void (*draw)(AudioRender::IDrawDevice*, int);
+    };
+    const Scene scenes[] = {{"rings", drawScene}, {"segmented", drawSegmentedPath}, {"scanlines", drawScanlines}};
+
+    for (const Scene& scene : scenes) {
+        for (bool simplify : {false, true}) {
+            auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+            WAVEFORMATEX wfx = makeFormat(16, false);
+            builder->Initialize(FramesPerPeriod, &wfx);
+            builder->setSimplification(simplify);
+
+            HeadlessConsumer consumer(builder.get());
+            AudioRender::FrameStats stats;
+            const int frames = 20;
+            for (int frame = 0; frame < frames; frame++) {
+                builder->WaitSync(1000);
+                scene.draw(builder.get(), frame);
+                builder->Submit();
+                stats = builder->GetFrameStats();
+            }
+            LOG("%-9s %-10s samples/frame %6zu  primitives %5zu -> %5zu", scene.name, simplify ? "simplified" : "original", stats.samples,
+                stats.primitivesBefore, stats.primitivesAfter);
+        }
+    }
+}
+
+// Petals made of cubic curves, either as curves or flattened to lines by the caller
+void drawPetals(AudioRender::IDrawDevice* device, int frame, bool flatten)
+{
+    const float pi = 3.14159f;
+    const int petals = 120;
+    const int segments = 32;  // lines per flattened curve
+    AudioRender::Point line[segments];
+
+    device->Begin();
+    for (int i = 0; i < petals; i++) {
+        const float a = frame * 0.01f + i * 2 * pi / petals;
+        const float r = 0.2f + 0.2f * (i % 3);
+        const AudioRender::Point p0{0, 0};
+        const AudioRender::Point c1{r * sinf(a - 0.3f), r * cosf(a - 0.3f)};
+        const AudioRender::Point c2{r * sinf(a + 0.3f), r * cosf(a + 0.3f)};
+        const AudioRender::Point p1{0.05f * sinf(a), 0.05f * cosf(a)};
+        device->SetPoint(p0);
+        if (!flatten) {
+            device->DrawCubic(c1, c2, p1);
+            continue;
+        }
+        for (int k = 0; k < segments; k++) {
+            const float t = (k + 1) / float(segments);
+            const float u = 1 - t;
+            const float w0 = u * u * u, w1 = 3 * u * u * t, w2 = 3 * u * t * t, w3 = t * t * t;
+            line[k] = {w0 * p0.x + w1 * c1.x + w2 * c2.x + w3 * p1.x, w0 * p0.y + w1 * c1.y + w2 * c2.y + w3 * p1.y};
+        }
+        for (const auto& p : line) device->DrawLine(p);
+    }
+}
+
+void benchmarkCurves()
+{
+    for (bool flatten : {true, false}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        double buildMs = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            auto start = Clock::now();
+            drawPetals(builder.get(), frame, flatten);
+            builder->Submit();
+            buildMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            stats = builder->GetFrameStats();
+        }
+        LOG("%-9s list %7zu bytes  samples/frame %6zu  build and encode %6.3f ms", flatten ? "flattened" : "curves", stats.listBytes, stats.samples,
+            buildMs / frames);
+    }
+}
+
+// Lissajous figure, spiral, rose and a function plot, drawn as parametric curves or sampled to polylines of a fixed
+// resolution by the application
+void drawCurveFamilies(AudioRender::IDrawDevice* device, int frame, bool sampled)
+{
+    using Curve = AudioRender::ParametricCurve;
+    const float pi = 3.14159f;
+    const AudioRender::ParametricCurve::Sinusoid rose{0.2f, 5, 0};
+    struct Figure {
+        std::shared_ptr<const Curve> curve;
+        float t0, t1;
+        AudioRender::Transform transform;
+    };
+    const Figure figures[] = {
+        {Curve::Lissajous(0.2f, 3, 0.2f, 4, frame * 0.02f), 0, 2 * pi, AudioRender::Transform::Translate(-0.25f, -0.25f)},
+        {Curve::Polar(0, 0.0075f), 0, 10 * pi, AudioRender::Transform::Translate(0.25f, -0.25f)},
+        {Curve::Polar(0, 0, &rose, 1), 0, 2 * pi, AudioRender::Transform::Translate(-0.25f, 0.25f)},
+        {Curve::Function([](float x) { return AudioRender::Point{x, -0.15f * sinf(40 * x) * expf(-50 * x * x)}; }), -0.2f, 0.2f,
+            AudioRender::Transform::Translate(0.25f, 0.25f)},
+    };
+
+    const int resolution = 500;  // points per sampled figure
+    std::vector<float> t(resolution);
+    std::vector<AudioRender::Point> points(resolution);
+    device->Begin();
+    for (const Figure& figure : figures) {
+        device->SetTransform(figure.transform);
+        if (!sampled) {
+            device->DrawParametric(figure.curve, figure.t0, figure.t1);
+            continue;
+        }
+        for (int i = 0; i < resolution; i++) t[i] = figure.t0 + (figure.t1 - figure.t0) * i / (resolution - 1);
+        figure.curve->Evaluate(t.data(), points.data(), resolution);
+        device->DrawPolyline(points.data(), resolution);
+    }
+}
+
+void benchmarkParametric()
+{
+    for (bool sampled : {true, false}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        double buildMs = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            auto start = Clock::now();
+            drawCurveFamilies(builder.get(), frame, sampled);
+            builder->Submit();
+            buildMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            stats = builder->GetFrameStats();
+        }
+        LOG("%-10s list %7zu bytes  samples/frame %6zu  build and encode %6.3f ms", sampled ? "polylines" : "parametric", stats.listBytes,
+            stats.samples, buildMs / frames);
+    }
+
+    // Evaluation of the same Lissajous figure by the built-in family and by a callback
+    const auto family = AudioRender::ParametricCurve::Lissajous(0.4f, 3, 0.4f, 4, 0.5f);
+    const auto callback = AudioRender::ParametricCurve::Function([](float t) { return AudioRender::Point{0.4f * sinf(3 * t + 0.5f), 0.4f * sinf(4 * t)}; });
+    const size_t count = 1 << 20;
+    std::vector<float> t(count);
+    std::vector<AudioRender::Point> points(count);
+    for (size_t i = 0; i < count; i++) t[i] = i * 6.28318f / count;
+    for (const auto& curve : {family, callback}) {
+        auto start = Clock::now();
+        curve->Evaluate(t.data(), points.data(), count);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        LOG("%-10s evaluate %6.1f M points/s", curve == family ? "family" : "callback", count / ms / 1000);
+    }
+}
+
+// Grid of small glyphs that scrolls every frame, drawn vertex by vertex or as instances of one shape
+void drawGlyph(AudioRender::IDrawDevice* device)
+{
+    const AudioRender::Point outline[] = {{0, 0}, {0, -10}, {4, -10}, {4, 0}, {0, 0}, {4, -10}};
+    device->DrawPolyline(outline, 6);
+    device->SetPoint({2, -5});
+    device->DrawCircle(1.5f);
+}
+
+void drawGlyphGrid(AudioRender::IDrawDevice* device, int frame, int shape)
+{
+    const float scale = 0.004f;
+    device->Begin();
+    for (int row = 0; row < 10; row++) {
+        for (int col = 0; col < 20; col++) {
+            const auto t = AudioRender::Transform::Translate(-0.45f + col * 0.045f + frame * 0.001f, -0.4f + row * 0.08f) *
+                           AudioRender::Transform::Scale(scale);
+            if (shape >= 0) {
+                device->DrawInstance(shape, t);
+                continue;
+            }
+            device->PushTransform(t);
+            drawGlyph(device);
+            device->PopTransform();
+        }
+    }
+}
+
+// Square or triangle outline recorded with a command buffer
+AudioRender::DisplayList recordOutline(bool square)
+{
+    AudioRender::CommandBuffer buffer;
+    if (square) {
+        const AudioRender::Point points[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+        buffer.DrawPolyline(points, 4, true);
+    } else {
+        const AudioRender::Point points[] = {{-1, 1}, {0, -1}, {1, 1}};
+        buffer.DrawPolyline(points, 3, true);
+    }
+    return buffer.Commands();
+}
+
+// Shape made in storage given by the caller, so that it can be made at the address of a released shape. Storage of
+// the shape is reused when released, like a separately allocated shape.
+std::shared_ptr<const AudioRender::DisplayList> makeShapeAt(void* storage, AudioRender::DisplayList&& list)
+{
+    return std::shared_ptr<const AudioRender::DisplayList>(new (storage) AudioRender::DisplayList(std::move(list)),
+                                                           [](const AudioRender::DisplayList* shape) { shape->~DisplayList(); });
+}
+
+// Output of a frame with a square instance, a frame without it and frames with a triangle instance. The square is
+// released before the triangle is made, at the address of the square if reused.
+std::vector<BYTE> replacedShapeOutput(bool reuseAddress)
+{
+    const size_t storageSize = sizeof(AudioRender::DisplayList) / sizeof(std::max_align_t) + 1;
+    std::vector<std::max_align_t> firstStorage(storageSize), secondStorage(storageSize);
+
+    WAVEFORMATEX wfx = makeFormat(32, true);
+    auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+    builder->Initialize(FramesPerPeriod, &wfx);
+    AudioRender::CommandBuffer buffer;
+    const AudioRender::CommandBuffer* buffers[] = {&buffer};
+    auto submitInstance = [&](const std::shared_ptr<const AudioRender::DisplayList>& shape) {
+        builder->Begin();
+        buffer.Reset();
+        if (shape) buffer.DrawInstance(shape, AudioRender::Transform::Scale(0.3f));
+        builder->SubmitCommandBuffers(buffers, 1);
+    };
+
+    auto first = makeShapeAt(firstStorage.data(), recordOutline(true));
+    submitInstance(first);
+    // lists of the device that refer to the square are replaced by this frame
+    submitInstance(nullptr);
+    first.reset();
+
+    auto second = makeShapeAt(reuseAddress ? firstStorage.data() : secondStorage.data(), recordOutline(false));
+    // the small frame needs many submits to fill the buffers read
+    for (int i = 0; i < 400; i++) submitInstance(second);
+    return readOutput(builder.get(), wfx.nBlockAlign, 0, size_t(FramesPerPeriod) * wfx.nBlockAlign * 10);
+}
+
+// Instance samples are cached over frames. A shape made at the address of a released one must not get its samples.
+bool checkReplacedShape()
+{
+    const std::vector<BYTE> replaced = replacedShapeOutput(true);
+    const std::vector<BYTE> reference = replacedShapeOutput(false);
+    const bool audible = std::any_of(reference.begin(), reference.end(), [](BYTE b) { return b != 0; });
+    const bool same = audible && replaced == reference;
+    LOG("%-9s shape at a released address plays like a new one: %s", "replaced", same ? "yes" : "NO");
+    if (!same) LOGE("Instance of a shape at the address of a released shape got the samples of the released shape");
+    return same;
+}
+
+// Fails if the replaced shape check fails
+bool benchmarkInstances()
+{
+    for (bool instanced : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+
+        int shape = -1;
+        if (instanced) {
+            builder->BeginShape();
+            drawGlyph(builder.get());
+            shape = builder->EndShape();
+        }
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        double buildMs = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            auto start = Clock::now();
+            drawGlyphGrid(builder.get(), frame, shape);
+            builder->Submit();
+            buildMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            stats = builder->GetFrameStats();
+        }
+        LOG("%-9s list %7zu bytes  samples/frame %6zu  build and encode %6.3f ms", instanced ? "instanced" : "direct", stats.listBytes, stats.samples,
+            buildMs / frames);
+    }
+    return checkReplacedShape();
+}
+
+// Rings on the background layer and a small gauge on layer 0
+void drawLayeredScene(AudioRender::IDrawDevice* device, int frame)
+{
+    device->Begin();
+    device->SetLayer(1);
+    drawRings(device, frame);
+    device->SetLayer(0);
+    const AudioRender::Point gauge[] = {{-0.45f, -0.45f}, {-0.45f + 0.002f * (frame % 100), -0.45f}, {-0.45f + 0.002f * (frame % 100), -0.42f}};
+    device->DrawPolyline(gauge, 3);
+}
+
+void benchmarkLayers()
+{
+    for (int divisor : {1, 2, 3}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->setLayerRefreshDivisor(1, divisor);
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            drawLayeredScene(builder.get(), frame);
+            builder->Submit();
+            stats = builder->GetFrameStats();
+        }
+        LOG("background divisor %d  samples/refresh %6zu  layer 0 %5zu samples %7.1f Hz  layer 1 %5zu samples %7.1f Hz", divisor, stats.samples,
+            stats.layerSamples[0], stats.layerRefreshRate[0], stats.layerSamples[1], stats.layerRefreshRate[1]);
+    }
+}
+
+// Few lines of HUD text, either at a fixed position or moving every frame
+void drawHud(AudioRender::IDrawDevice* device, int frame, bool scrolling)
+{
+    const float x = scrolling ? -0.45f + frame * 0.001f : -0.45f;
+    device->Begin();
+    device->DrawText("SCORE 0012340\nFUEL  87\nALT   1520 M\nLEVEL 3", {x, -0.38f}, 0.04f);
+}
+
+void benchmarkText()
+{
+    for (bool scrolling : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        double buildMs = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            auto start = Clock::now();
+            drawHud(builder.get(), frame, scrolling);
+            builder->Submit();
+            buildMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            stats = builder->GetFrameStats();
+        }
+        LOG("%-9s list %7zu bytes  samples/frame %6zu  build and encode %6.3f ms", scrolling ? "scrolling" : "static", stats.listBytes, stats.samples,
+            buildMs / frames);
+    }
+}
+
+// Large frame like a detailed vector image, takes several milliseconds to encode
+void drawLargeFrame(AudioRender::IDrawDevice* device, int frame)
+{
+    device->Begin();
+    for (int i = 0; i < 40; i++) {
+        device->PushTransform(AudioRender::Transform::Scale(0.2f + 0.05f * i));
+        drawRings(device, frame + i);
+        device->PopTransform();
+    }
+}
+
+// Time from Submit until the first buffer of a large frame can be played and until the whole frame is encoded.
+// Frame is encoded on the encoder thread, the queue is empty when it is submitted.
+void benchmarkProgressive()
+{
+    for (bool progressive : {false, true}) {
+        double firstMs = 0;
+        double encodedMs = 0;
+        size_t samples = 0;
+        const int frames = 10;
+        for (int frame = 0; frame < frames; frame++) {
+            auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+            WAVEFORMATEX wfx = makeFormat(16, false);
+            builder->Initialize(FramesPerPeriod, &wfx);
+            builder->setProgressiveSubmit(progressive);
+            builder->setPipelined(true);
+
+            drawLargeFrame(builder.get(), frame);
+            std::vector<BYTE> buffer(builder->GetBufferLength());
+            auto start = Clock::now();
+            builder->Submit();
+            for (;;) {
+                builder->FillSampleBuffer(UINT32(buffer.size()), buffer.data());
+                if (std::any_of(buffer.begin(), buffer.end(), [](BYTE b) { return b != 0; })) break;
+                std::this_thread::yield();
+            }
+            firstMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            builder->setPipelined(false);
+            encodedMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            samples = builder->GetFrameStats().samples;
+        }
+        LOG("%-11s samples/frame %6zu  first buffer after %7.3f ms  encoded after %7.3f ms", progressive ? "progressive" : "whole frame", samples,
+            firstMs / frames, encodedMs / frames);
+    }
+}
+
+// Ring pattern on a generic recording target, IDrawDevice or CommandBuffer
+template <typename Target>
+void drawRingPart(Target& target, int frame, int part)
+{
+    const float pi = 3.14159f;
+    const float rot = frame * pi / 180;
+    target.PushTransform(AudioRender::Transform::Scale(0.4f + 0.15f * part));
+    target.SetIntensity(0.2f);
+    for (int i = 0; i < 20000; i++) {
+        const float a = rot + i * 2 * pi / 20000;
+        const float r = 0.2f + 0.05f * sinf(i * 0.1f + part);
+        const AudioRender::Point p{r * sinf(a), r * cosf(a)};
+        if (i % 50 == 0) {
+            target.SetPoint(p);
+        } else {
+            target.DrawLine(p);
+        }
+    }
+    target.PopTransform();
+}
+
+// Scene of four large parts recorded on the device, or into command buffers on worker threads
+void benchmarkThreads()
+{
+    const int parts = 4;
+    for (bool threaded : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->setPipelined(true);
+
+        AudioRender::CommandBuffer buffers[parts];
+        const AudioRender::CommandBuffer* bufferList[parts] = {&buffers[0], &buffers[1], &buffers[2], &buffers[3]};
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        double recordMs = 0;
+        double submitMs = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            auto start = Clock::now();
+            builder->Begin();
+            if (threaded) {
+                std::thread workers[parts];
+                for (int part = 0; part < parts; part++) {
+                    workers[part] = std::thread([&, part] {
+                        buffers[part].Reset();
+                        drawRingPart(buffers[part], frame, part);
+                    });
+                }
+                for (auto& worker : workers) worker.join();
+            } else {
+                for (int part = 0; part < parts; part++) drawRingPart(*builder, frame, part);
+            }
+            auto recorded = Clock::now();
+            if (threaded) {
+                builder->SubmitCommandBuffers(bufferList, parts);
+            } else {
+                builder->Submit();
+            }
+            recordMs += std::chrono::duration<double, std::milli>(recorded - start).count();
+            submitMs += std::chrono::duration<double, std::milli>(Clock::now() - recorded).count();
+            stats = builder->GetFrameStats();
+        }
+        builder->setPipelined(false);
+        LOG("%-15s list %7zu bytes  samples/frame %6zu  record %6.3f ms  submit %6.3f ms  (%u hardware threads)",
+            threaded ? "command buffers" : "device", stats.listBytes, stats.samples, recordMs / frames, submitMs / frames,
+            std::thread::hardware_concurrency());
+    }
+}
+
+// Torus with rings x segments quads, edges of each ring are added in order so that they join into one path
+AudioRender::LineMesh makeTorus(int rings, int segments)
+{
+    const float pi = 3.14159f;
+    AudioRender::LineMesh mesh;
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) {
+            const float u = i * 2 * pi / rings;
+            const float v = j * 2 * pi / segments;
+            mesh.AddVertex({(1.0f + 0.4f * cosf(v)) * cosf(u), (1.0f + 0.4f * cosf(v)) * sinf(u), 0.4f * sinf(v)});
+        }
+    }
+    auto vertex = [&](int i, int j) { return uint32_t((i % rings) * segments + j % segments); };
+    for (int j = 0; j < segments; j++) {
+        for (int i = 0; i < rings; i++) mesh.AddEdge(vertex(i, j), vertex(i + 1, j));
+    }
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) mesh.AddEdge(vertex(i, j), vertex(i, j + 1));
+    }
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) {
+            mesh.AddTriangle(vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1));
+            mesh.AddTriangle(vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1));
+        }
+    }
+    mesh.UpdateAdjacency();
+    return mesh;
+}
+
+// Rotating torus of 6144 edges with and without culling
+void benchmarkWireframe()
+{
+    const AudioRender::LineMesh torus = makeTorus(96, 32);
+    struct Mode {
+        const char* name;
+        bool backFaces;
+        bool hiddenLines;
+    };
+    const Mode modes[] = {{"all edges", false, false}, {"back faces", true, false}, {"hidden lines", true, true}};
+
+    for (const Mode& mode : modes) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+
+        AudioRender::WireframeRenderer renderer;
+        renderer.SetProjection(glm::perspective(0.8f, 1.0f, 0.1f, 100.0f));
+        renderer.SetView(glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0), glm::vec3(0, 1, 0)));
+        renderer.SetBackFaceCulling(mode.backFaces);
+        renderer.SetHiddenLineRemoval(mode.hiddenLines);
+
+        HeadlessConsumer consumer(builder.get());
+        AudioRender::FrameStats stats;
+        AudioRender::WireframeRenderer::Stats meshStats;
+        double projectMs = 0;
+        const int frames = 20;
+        for (int frame = 0; frame < frames; frame++) {
+            builder->WaitSync(1000);
+            builder->Begin();
+            renderer.SetModel(glm::rotate(glm::rotate(glm::mat4(1.0f), frame * 0.05f, glm::vec3(0, 1, 0)), 1.0f, glm::vec3(1, 0, 0)));
+            meshStats = renderer.Draw(torus, *builder);
+            builder->Submit();
+            projectMs += meshStats.elapsedMs;
+            stats = builder->GetFrameStats();
+        }
+        LOG("%-12s edges %5zu  back facing %5zu  hidden %5zu  paths %5zu  project %6.3f ms  samples/frame %6zu", mode.name, meshStats.edges,
+            meshStats.backFacing, meshStats.hidden, meshStats.paths, projectMs / frames, stats.samples);
+    }
+}
+
+// Heap allocations per frame once the frame has been drawn a few times. Scene changes on every frame, so each
+// frame is prepared and encoded again.
+// Parametric curves that cross the edge of the viewport, so that they are clipped. Curves are created once, like an
+// application would keep them. Motion repeats within the warmup, so that buffers have reached their size.
+void drawClippedCurves(AudioRender::IDrawDevice* device, int frame)
+{
+    using Curve = AudioRender::ParametricCurve;
+    static const std::shared_ptr<const Curve> lissajous = Curve::Lissajous(0.4f, 3, 0.4f, 4, 0.5f);
+    static const std::shared_ptr<const Curve> spiral = Curve::Polar(0, 0.02f);
+    device->Begin();
+    device->SetTransform(AudioRender::Transform::Translate(0.8f - 0.01f * (frame % 10), 0));
+    device->DrawParametric(lissajous, 0, 2 * 3.14159f);
+    device->SetTransform(AudioRender::Transform::Translate(-0.7f, -0.7f));
+    device->DrawParametric(spiral, 0, 8 * 3.14159f);
+}
+
+void benchmarkAllocations()
+{
+    struct Scene {
+        const char* name;
+        void (*draw)(AudioRender::IDrawDevice*, int);
+    };
+    const Scene scenes[] = {{"rings", drawScene}, {"text", [](AudioRender::IDrawDevice* device, int frame) { drawHud(device, frame, true); }},
+        {"layers", drawLayeredScene}, {"curves", drawClippedCurves}};
+
+    for (const Scene& scene : scenes) {
+        for (bool pipelined : {false, true}) {
+            auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+            WAVEFORMATEX wfx = makeFormat(16, false);
+            builder->Initialize(FramesPerPeriod, &wfx);
+            builder->setPathOptimization(true);
+            builder->setSimplification(true);
+            builder->SetClipping(true);
+            builder->setPipelined(pipelined);
+
+            HeadlessConsumer consumer(builder.get());
+            const int warmup = 10;
+            const int frames = 50;
+            for (int frame = 0; frame < warmup + frames; frame++) {
+                builder->WaitSync(1000);
+                if (frame == warmup) s_countAllocations = true;
+                scene.draw(builder.get(), frame);
+                builder->Submit();
+            }
+            // last frame has been encoded when the encoder thread is stopped
+            builder->setPipelined(false);
+            s_countAllocations = false;
+
+            const auto stats = builder->GetFrameStats();
+            LOG("%-7s %-11s heap allocations/frame %7.2f  scratch %6zu bytes  scratch allocations %llu", scene.name,
+                pipelined ? "pipelined" : "synchronous", double(s_allocations.exchange(0)) / frames, stats.scratchBytes,
+                (unsigned long long)stats.scratchAllocations);
+        }
+    }
+}
+
+// Marker of the latency benchmark, a short vertical line above the scene at a position that tells the frame
+const float LatchMarkerTop = 0.7f;
+const float LatchMarkerBottom = 0.8f;
+float latchMarkerX(int frame) { return -0.5f + 0.002f * frame; }
+
+// Circles with the marker as the moving object, drawn with a transform or placed by transform slot 0
+void drawLatchScene(AudioRender::IDrawDevice* device, int frame, bool latched)
+{
+    device->Begin();
+    device->SetIntensity(0.3f);
+    for (int i = 0; i < 8; i++) {
+        device->SetPoint({0.3f * sinf(i * 0.785f), 0.3f * cosf(i * 0.785f)});
+        device->DrawCircle(0.1f);
+    }
+
+    const AudioRender::Transform position = AudioRender::Transform::Translate(latchMarkerX(frame), 0);
+    if (latched) {
+        device->UpdateTransformSlot(0, position);
+        device->SetTransformSlot(0);
+    } else {
+        device->SetTransform(position);
+    }
+    device->SetIntensity(0.5f);
+    const AudioRender::Point marker[] = {{0, LatchMarkerTop}, {0, LatchMarkerBottom}};
+    device->DrawPolyline(marker, 2);
+}
+
+struct LatencyStats {
+    double avgMs = 0;
+    double maxMs = 0;
+    int shown = 0;  // positions that were seen on the output
+    double fillAvgMs = 0;
+    double fillMaxMs = 0;
+};
+
+// Time from the position update of the marker until the output shows it. Output is paced like an audio device and
+// the application waits for the device like a game loop.
+LatencyStats measureUpdateLatency(AudioRender::AudioGraphicsBuilder& builder, UINT32 period, int frames, bool latched)
+{
+    std::vector<Clock::time_point> updated(frames);
+    std::vector<double> latencyMs(frames, -1);
+    LatencyStats stats;
+    uint64_t fills = 0;
+    std::atomic_bool running = true;
+    std::thread output([&] {
+        std::vector<BYTE> buffer(builder.GetBufferLength());
+        auto next = Clock::now();
+        int shown = -1;
+        while (running) {
+            next += std::chrono::microseconds(period * 1000000 / 48000);
+            std::this_thread::sleep_until(next);
+            auto start = Clock::now();
+            builder.FillSampleBuffer(UINT32(buffer.size()), buffer.data());
+            const double fillMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            stats.fillAvgMs += fillMs;
+            stats.fillMaxMs = std::max(stats.fillMaxMs, fillMs);
+            fills++;
+
+            const short* samples = reinterpret_cast<const short*>(buffer.data());
+            for (size_t i = 0; i < buffer.size() / sizeof(short); i += 2) {
+                const float y = samples[i + 1] / 32767.0f;
+                if (y < LatchMarkerTop - 0.01f || y > LatchMarkerBottom + 0.01f) continue;
+                const int frame = int(lroundf((samples[i] / 32767.0f - latchMarkerX(0)) / 0.002f));
+                if (frame <= shown || frame >= frames) continue;
+                latencyMs[frame] = std::chrono::duration<double, std::milli>(Clock::now() - updated[frame]).count();
+                shown = frame;
+            }
+        }
+    });
+
+    for (int frame = 0; frame < frames; frame++) {
+        builder.WaitSync(1000);
+        updated[frame] = Clock::now();
+        drawLatchScene(&builder, frame, latched);
+        builder.Submit();
+    }
+    running = false;
+    output.join();
+
+    for (double ms : latencyMs) {
+        if (ms < 0) continue;
+        stats.avgMs += ms;
+        stats.maxMs = std::max(stats.maxMs, ms);
+        stats.shown++;
+    }
+    if (stats.shown) stats.avgMs /= stats.shown;
+    if (fills) stats.fillAvgMs /= fills;
+    return stats;
+}
+
+// Object modelled in its own units, a few units across, placed on the viewport by slot 0 or by the recorded
+// transform. Clipping cuts off the part that sticks out of the viewport.
+void drawScaledSlotScene(AudioRender::IDrawDevice* device, const AudioRender::Transform& place, bool slot)
+{
+    device->Begin();
+    device->SetClipping(true);
+    if (slot) {
+        device->UpdateTransformSlot(0, place);
+        device->SetTransformSlot(0);
+    } else {
+        device->SetTransform(place);
+    }
+    const AudioRender::Point hull[] = {{-2.5f, 2.5f}, {0, -2.5f}, {2.5f, 2.5f}, {0, 1.5f}};
+    device->DrawPolyline(hull, 4, true);
+    device->SetPoint({0, 0});
+    device->DrawCircle(1.5f);
+}
+
+// Output of the object, queued with repeated Submits or encoded just in time. The small object needs many frames
+// to fill the queued buffers. Slot is moved to the latched transform after the frames have been submitted.
+std::vector<BYTE> scaledSlotOutput(bool justInTime, const AudioRender::Transform& place, bool slot, const AudioRender::Transform& latched,
+    size_t& samples)
+{
+    WAVEFORMATEX wfx = makeFormat(32, true);
+    auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+    builder->Initialize(FramesPerPeriod, &wfx);
+    builder->setJustInTime(justInTime);
+    for (int i = 0; i < (justInTime ? 1 : 400); i++) {
+        drawScaledSlotScene(builder.get(), place, slot);
+        builder->Submit();
+    }
+    if (slot) builder->UpdateTransformSlot(0, latched);
+    std::vector<BYTE> output = readOutput(builder.get(), wfx.nBlockAlign, 0, size_t(FramesPerPeriod) * wfx.nBlockAlign * 10);
+    samples = builder->GetFrameStats().samples;
+    return output;
+}
+
+// Slot geometry is clipped and sampled with the slot scale, like geometry under a recorded transform, and a slot
+// moved after the submit shows the geometry at the new place. Fails if the slot output differs from the transformed
+// one.
+bool checkScaledSlot()
+{
+    using AudioRender::Transform;
+    struct Case {
+        const char* name;
+        Transform submitted;
+        Transform latched;
+    };
+    const Case cases[] = {
+        {"clipped", Transform::Translate(0.4f, 0.1f) * Transform::Scale(0.08f), Transform::Translate(0.4f, 0.1f) * Transform::Scale(0.08f)},
+        {"moved", Transform::Translate(-0.2f, 0) * Transform::Scale(0.05f),
+            Transform::Translate(0.1f, -0.1f) * Transform::Rotate(0.5f) * Transform::Scale(0.05f)},
+    };
+
+    bool ok = true;
+    for (const Case& c : cases) {
+        for (bool justInTime : {false, true}) {
+            size_t transformSamples = 0, slotSamples = 0;
+            const std::vector<BYTE> transformed = scaledSlotOutput(justInTime, c.latched, false, c.latched, transformSamples);
+            const std::vector<BYTE> slotted = scaledSlotOutput(justInTime, c.submitted, true, c.latched, slotSamples);
+            const float* a = reinterpret_cast<const float*>(transformed.data());
+            const float* b = reinterpret_cast<const float*>(slotted.data());
+            float maxError = 0, peak = 0;
+            for (size_t i = 0; i < transformed.size() / sizeof(float); i++) {
+                maxError = std::max(maxError, fabsf(a[i] - b[i]));
+                peak = std::max(peak, fabsf(b[i]));
+            }
+            // silent output would match anything
+            const bool same = slotSamples == transformSamples && maxError < 1e-5f && peak > 0;
+            LOG("%-8s %-12s slot samples/frame %4zu  transform %4zu  max difference %.7f  %s", c.name, justInTime ? "just in time" : "queued",
+                slotSamples, transformSamples, maxError, same ? "ok" : "MISMATCH");
+            if (!same) ok = false;
+        }
+    }
+    if (!ok) LOGE("Slot geometry differs from the same geometry under a transform");
+    return ok;
+}
+
+// Latency of a moving object drawn with a transform and placed by a transform slot that is latched when the output
+// takes a buffer. Output has short buffers. Fails if the scaled slot check fails.
+bool benchmarkLatching()
+{
+    const UINT32 period = 96;  // 2 ms at 48 kHz
+    const int frames = 200;
+    for (bool latched : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(period, &wfx);
+
+        const LatencyStats stats = measureUpdateLatency(*builder, period, frames, latched);
+        LOG("%-9s samples/frame %6zu  update to output avg %6.2f ms  max %6.2f ms  (%d of %d positions shown)", latched ? "slot" : "transform",
+            builder->GetFrameStats().samples, stats.avgMs, stats.maxMs, stats.shown, frames);
+    }
+    return checkScaledSlot();
+}
+
+// Rows of glyphs on two layers, rows are instances of a shape of glyph instances
+AudioRender::DisplayList recordGlyphRows()
+{
+    AudioRender::CommandBuffer glyph;
+    const AudioRender::Point outline[] = {{0, 0}, {0, -10}, {4, -10}, {4, 0}, {0, 0}, {4, -10}};
+    glyph.DrawPolyline(outline, 6);
+    glyph.SetPoint({2, -5});
+    glyph.DrawCircle(1.5f);
+    auto glyphShape = std::make_shared<const AudioRender::DisplayList>(glyph.Commands());
+
+    AudioRender::CommandBuffer row;
+    for (int col = 0; col < 8; col++) row.DrawInstance(glyphShape, AudioRender::Transform::Translate(col * 6.0f, 0));
+    auto rowShape = std::make_shared<const AudioRender::DisplayList>(row.Commands());
+
+    AudioRender::CommandBuffer frame;
+    for (int r = 0; r < 4; r++) {
+        frame.SetLayer(r % 2);
+        frame.DrawInstance(rowShape, AudioRender::Transform::Translate(-0.4f, -0.3f + r * 0.2f) * AudioRender::Transform::Scale(0.01f), 0.3f);
+        frame.SetPoint({-0.5f, -0.35f + r * 0.2f});
+        frame.DrawLine({0.5f, -0.35f + r * 0.2f});
+    }
+    return frame.Commands();
+}
+
+bool samePrimitive(const AudioRender::DisplayList::Primitive& a, const AudioRender::DisplayList::Primitive& b)
+{
+    auto samePoint = [](AudioRender::Point p, AudioRender::Point q) { return p.x == q.x && p.y == q.y; };
+    return a.type == b.type && a.r == b.r && a.intensity == b.intensity && a.toIntensity == b.toIntensity && samePoint(a.p, b.p) &&
+           samePoint(a.toPoint, b.toPoint) && samePoint(a.axisX, b.axisX) && samePoint(a.axisY, b.axisY);
+}
+
+// Audio thread continues a refresh in a new frame from a read position. Reading resumed at any primitive continues like
+// reading the whole list.
+bool checkReadPositions()
+{
+    const AudioRender::DisplayList list = recordGlyphRows();
+    std::vector<AudioRender::DisplayList::Primitive> primitives;
+    std::vector<int> layers;
+    AudioRender::DisplayList::Reader reader(list);
+    AudioRender::DisplayList::Primitive p;
+    while (reader.Next(p)) {
+        primitives.push_back(p);
+        layers.push_back(reader.Layer());
+    }
+
+    std::vector<AudioRender::DisplayList::Reader::Position> positions;
+    std::vector<size_t> primitivePositions;
+    AudioRender::DisplayList::Reader::ReadPositions(list, positions, primitivePositions);
+    bool ok = primitivePositions.size() == primitives.size() + 1;
+    AudioRender::DisplayList::Reader resumed(list);
+    for (size_t start = 0; ok && start < primitivePositions.size(); start++) {
+        resumed.Seek(positions, primitivePositions[start]);
+        for (size_t i = start; ok && i < primitives.size(); i++) ok = resumed.Next(p) && samePrimitive(p, primitives[i]) && resumed.Layer() == layers[i];
+        ok = ok && !resumed.Next(p);
+    }
+    LOG("%-12s %zu primitives in %zu read positions  resumed reading %s", "positions", primitives.size(), positions.size(),
+        ok ? "ok" : "MISMATCH");
+    if (!ok) LOGE("Reading resumed from a read position differs from reading the whole list");
+    return ok;
+}
+
+// Latency of queued frames and of frames encoded by the audio thread when it fills a buffer, and the time the audio
+// thread spends in FillSampleBuffer. Fails if the read position check fails.
+bool benchmarkJustInTime()
+{
+    const UINT32 period = 96;  // 2 ms at 48 kHz
+    const int frames = 200;
+    for (bool justInTime : {false, true}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(period, &wfx);
+        builder->setJustInTime(justInTime);
+
+        const LatencyStats stats = measureUpdateLatency(*builder, period, frames, false);
+        LOG("%-12s update to output avg %6.2f ms  max %6.2f ms  (%d of %d positions shown)  fill avg %6.3f ms  max %6.3f ms",
+            justInTime ? "just in time" : "queued", stats.avgMs, stats.maxMs, stats.shown, frames, stats.fillAvgMs, stats.fillMaxMs);
+    }
+    return checkReadPositions();
+}
+
+// Producer and consumer threads pass slots through a small ring. Every slot carries its sequence number and a fill
+// pattern derived from it, the consumer checks that slots arrive in order and intact. Consumer discards the ring
+// now and then, after which the sequence may skip ahead but not back.
+bool stressSampleRing(size_t slotSize, size_t count, uint64_t slots)
+{
+    AudioRender::SampleRing ring;
+    ring.Allocate(slotSize, count);
+
+    std::atomic_bool done = false;
+    auto start = Clock::now();
+    std::thread producer([&] {
+        for (uint64_t seq = 0; seq < slots;) {
+            uint8_t* slot = ring.Back();
+            if (!slot) {
+                std::this_thread::yield();
+                continue;
+            }
+            memcpy(slot, &seq, sizeof(seq));
+            memset(slot + sizeof(seq), int(seq & 0xff), slotSize - sizeof(seq));
+            ring.Push();
+            seq++;
+        }
+        done = true;
+    });
+
+    uint64_t received = 0;
+    uint64_t discards = 0;
+    uint64_t errors = 0;
+    uint64_t next = 0;
+    bool discarded = false;  // slots up to the first one after a discard may have been dropped
+    size_t maxSize = 0;
+    for (;;) {
+        maxSize = std::max(maxSize, ring.Size());
+        const uint8_t* slot = ring.Front();
+        if (!slot) {
+            if (done && !ring.Front()) break;
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t seq;
+        memcpy(&seq, slot, sizeof(seq));
+        bool intact = discarded ? seq >= next : seq == next;
+        for (size_t i = sizeof(seq); i < slotSize && intact; i++) intact = slot[i] == uint8_t(seq & 0xff);
+        if (!intact) errors++;
+        next = seq + 1;
+        discarded = false;
+        received++;
+        ring.Pop();
+
+        if (received % 100003 == 0) {
+            ring.Discard();
+            discards++;
+            discarded = true;
+        }
+    }
+    producer.join();
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    LOG("%-10s slot %5zu bytes x %3zu  received %8llu  discards %3llu  errors %llu  max size %3zu  %7.1f ms", "stress", slotSize, count,
+        (unsigned long long)received, (unsigned long long)discards, (unsigned long long)errors, maxSize, ms);
+    return errors == 0;
+}
+
+// Buffers per second through the ring with a producer that fills whole slots and a consumer that copies them out
+void measureSampleRing(size_t slotSize, size_t count, uint64_t slots)
+{
+    AudioRender::SampleRing ring;
+    ring.Allocate(slotSize, count);
+    std::vector<uint8_t> source(slotSize, 0x55);
+    std::vector<uint8_t> output(slotSize);
+
+    auto start = Clock::now();
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < slots;) {
+            uint8_t* slot = ring.Back();
+            if (!slot) {
+                std::this_thread::yield();
+                continue;
+            }
+            memcpy(slot, source.data(), slotSize);
+            ring.Push();
+            i++;
+        }
+    });
+    for (uint64_t i = 0; i < slots;) {
+        const uint8_t* slot = ring.Front();
+        if (!slot) {
+            std::this_thread::yield();
+            continue;
+        }
+        memcpy(output.data(), slot, slotSize);
+        ring.Pop();
+        i++;
+    }
+    producer.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    LOG("%-10s slot %5zu bytes x %3zu  %7.2f M buffers/s  %8.1f MB/s", "throughput", slotSize, count, slots / seconds / 1e6,
+        slots * slotSize / seconds / 1e6);
+}
+
+// Fails if the stress test receives slots out of order or corrupted
+bool benchmarkSampleRing()
+{
+    bool intact = stressSampleRing(24, 4, 2000000);
+    intact = stressSampleRing(1920, 128, 500000) && intact;
+    // 2 ms and 10 ms of 16-bit stereo at 48 kHz
+    measureSampleRing(96 * 4, 128, 2000000);
+    measureSampleRing(480 * 4, 128, 1000000);
+    if (!intact) LOGE("Sample ring stress test failed");
+    return intact;
+}
+
+// Per frame converters that the encoder used before the conversion kernels, reference for their output
+void legacyWriteSample(int bits, uint8_t* buffer, float x, float y)
+{
+    auto toShort = [](float v) {
+        const float r = roundf(v * 32767);
+        const float high = 32767 > r ? r : 32767;
+        return (short)(-32768 < high ? high : -32768);
+    };
+    if (bits == 16) {
+        short* pcm = reinterpret_cast<short*>(buffer);
+        pcm[0] = toShort(x);
+        pcm[1] = toShort(y);
+    } else if (bits == 24) {
+        const int32_t vx = (int32_t)roundf(x * 2147483647) >> 8;
+        const int32_t vy = (int32_t)roundf(y * 2147483647) >> 8;
+        const uint8_t bytes[6] = {uint8_t(vx), uint8_t(vx >> 8), uint8_t(vx >> 16), uint8_t(vy), uint8_t(vy >> 8), uint8_t(vy >> 16)};
+        memcpy(buffer, bytes, 6);
+    } else {
+        float* flt = reinterpret_cast<float*>(buffer);
+        flt[0] = x;
+        flt[1] = y;
+    }
+}
+
+struct ConvertFormat {
+    const char* name;
+    int bits;
+    AudioRender::SampleConversion::Converter vector;
+    AudioRender::SampleConversion::Converter scalar;
+};
+
+const ConvertFormat convertFormats[] = {
+    {"pcm16", 16, AudioRender::SampleConversion::ToPCM16, AudioRender::SampleConversion::ToPCM16Scalar},
+    {"pcm24", 24, AudioRender::SampleConversion::ToPCM24, AudioRender::SampleConversion::ToPCM24Scalar},
+    {"float", 32, AudioRender::SampleConversion::ToFloat, AudioRender::SampleConversion::ToFloatScalar},
+};
+
+// Coordinates at and around every rounding boundary and the ends of the range of the format, and random ones. The
+// old 24-bit converter overflowed at 1 and above, so inRange keeps below it.
+std::vector<float> conversionInputs(int bits, bool inRange)
+{
+    std::vector<float> v = {0.0f, -0.0f, -1.0f, nextafterf(1.0f, 0.0f), 0.5f, -0.5f, 1e-30f, -1e-30f};
+    const float top = inRange ? nextafterf(1.0f, 0.0f) : 1.5f;
+    if (bits == 16) {
+        for (int i = -32769; i <= 32768; i++) {
+            const float b = (i + 0.5f) / 32767.0f;
+            for (float f : {nextafterf(b, -2.0f), b, nextafterf(b, 2.0f), i / 32767.0f}) {
+                if (f >= -1.0f && f <= top) v.push_back(f);
+            }
+        }
+    } else if (bits == 24) {
+        // 24-bit values are rounded at 2^-31 and floored at 2^-23
+        for (int i = -300; i <= 300; i++) {
+            for (float f : {(i + 0.5f) * 4.656613e-10f, i * 1.192093e-7f, nextafterf(i * 1.192093e-7f, -1.0f)}) v.push_back(f);
+        }
+    }
+    if (!inRange) {
+        for (float f : {1.0f, 1.0001f, -1.0001f, 2.0f, -2.0f, 1e30f, -1e30f, INFINITY, -INFINITY, NAN}) v.push_back(f);
+    }
+    uint32_t seed = 12345;
+    for (int i = 0; i < 100000; i++) {
+        seed = seed * 1664525 + 1013904223;
+        const float r = (seed >> 8) / 16777216.0f;  // [0, 1)
+        v.push_back(inRange ? r * 2 - 1 : r * 3 - 1.5f);
+    }
+    return v;
+}
+
+// Frames that differ between the kernel and the reference. Odd counts and offsets exercise the scalar remainders.
+size_t countMismatches(const ConvertFormat& format, const std::vector<float>& values, bool legacy)
+{
+    const size_t frameSize = format.bits / 8 * 2;
+    std::vector<float> x(values.begin(), values.end());
+    std::vector<float> y(values.rbegin(), values.rend());
+    std::vector<uint8_t> out(values.size() * frameSize);
+    std::vector<uint8_t> expected(values.size() * frameSize);
+    for (size_t offset = 0; offset < 3; offset++) {
+        const size_t count = values.size() - offset;
+        format.vector(x.data() + offset, y.data() + offset, count, out.data());
+        for (size_t i = 0; i < count; i++) {
+            if (legacy) {
+                legacyWriteSample(format.bits, expected.data() + i * frameSize, x[offset + i], y[offset + i]);
+            } else {
+                format.scalar(x.data() + offset + i, y.data() + offset + i, 1, expected.data() + i * frameSize);
+            }
+        }
+        size_t mismatches = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (memcmp(out.data() + i * frameSize, expected.data() + i * frameSize, frameSize)) mismatches++;
+        }
+        if (mismatches) return mismatches;
+    }
+    return 0;
+}
+
+// Points per second converted one frame at a time with the old converters and in runs with the scalar and
+// vectorized kernels
+void measureConversion(const ConvertFormat& format)
+{
+    const size_t run = 256;
+    const int runs = 20000;
+    const size_t frameSize = format.bits / 8 * 2;
+    std::vector<float> x(run), y(run);
+    for (size_t i = 0; i < run; i++) {
+        x[i] = 0.8f * sinf(i * 0.05f);
+        y[i] = 0.8f * cosf(i * 0.07f);
+    }
+    std::vector<uint8_t> out(run * frameSize);
+
+    auto rate = [&](auto&& convert) {
+        auto start = Clock::now();
+        for (int r = 0; r < runs; r++) {
+            x[r % run] += 1e-7f;  // keeps the compiler from hoisting the work
+            convert();
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return double(run) * runs / seconds / 1e6;
+    };
+    const double legacy = rate([&] {
+        for (size_t i = 0; i < run; i++) legacyWriteSample(format.bits, out.data() + i * frameSize, x[i], y[i]);
+    });
+    const double scalar = rate([&] { format.scalar(x.data(), y.data(), run, out.data()); });
+    const double vector = rate([&] { format.vector(x.data(), y.data(), run, out.data()); });
+    LOG("%-6s per frame %8.1f  scalar run %8.1f  vector run %8.1f  M points/s", format.name, legacy, scalar, vector);
+}
+
+// Conversion kernels must match the old converters bit for bit within their range and the scalar kernels
+// everywhere, including out of range and non-finite coordinates
+void benchmarkConversion()
+{
+    for (const auto& format : convertFormats) {
+        const size_t legacy = countMismatches(format, conversionInputs(format.bits, true), true);
+        const size_t scalar = countMismatches(format, conversionInputs(format.bits, false), false);
+        LOG("%-6s mismatches against old converters %zu  against scalar kernels %zu", format.name, legacy, scalar);
+    }
+    for (const auto& format : convertFormats) measureConversion(format);
+
+    LOG("Synchronous Submit of the rings scene, %d frames", BenchmarkFrames);
+    for (const auto& format : convertFormats) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(WORD(format.bits), format.bits == 32);
+        builder->Initialize(FramesPerPeriod, &wfx);
+        FrameTimes times;
+        {
+            HeadlessConsumer consumer(builder.get());
+            times = measureFrames(*builder);
+        }
+        LOG("%-6s frame avg %7.3f ms  max %7.3f ms", format.name, times.avgMs, times.maxMs);
+    }
+}
+
+// Run conversion that the encoder used before the converter was selected on Initialize, branching on the sample type
+// on every run. Type is reloaded on each call like the member it was.
+volatile int s_referenceBits = 16;
+
+void referenceConvertSamples(const float* x, const float* y, size_t count, uint8_t* out)
+{
+    const int bits = s_referenceBits;
+    if (bits == 16) {
+        AudioRender::SampleConversion::ToPCM16(x, y, count, out);
+    } else if (bits == 24) {
+        AudioRender::SampleConversion::ToPCM24(x, y, count, out);
+    } else if (bits == 32) {
+        AudioRender::SampleConversion::ToFloat(x, y, count, out);
+    }
+}
+
+// Cost of a converted sample through the type branch and through the selected converter, on full runs and on single
+// frames like latched samples
+void measureDispatch(const ConvertFormat& format)
+{
+    const size_t total = 1 << 22;
+    const size_t RunLength = 256;  // points the encoder converts at a time
+    std::vector<float> x(RunLength), y(RunLength);
+    for (size_t i = 0; i < RunLength; i++) {
+        x[i] = sinf(float(i));
+        y[i] = cosf(float(i));
+    }
+    std::vector<uint8_t> out(RunLength * 8);
+    s_referenceBits = format.bits;
+    // pointer is reloaded on each call like the member it is in the encoder
+    AudioRender::SampleConversion::Converter volatile selected = format.vector;
+
+    auto nsPerSample = [&](size_t run, bool reference) {
+        auto start = Clock::now();
+        for (size_t done = 0; done < total; done += run) {
+            if (reference) {
+                referenceConvertSamples(x.data(), y.data(), run, out.data());
+            } else {
+                selected(x.data(), y.data(), run, out.data());
+            }
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / total;
+    };
+    for (size_t run : {RunLength, size_t(1)}) {
+        LOG("%-6s run %3zu  type branch %6.2f ns/sample  selected converter %6.2f ns/sample", format.name, run, nsPerSample(run, true),
+            nsPerSample(run, false));
+    }
+}
+
+// Encoding cost of a sample in each output format, on synchronous Submit of a changing scene and on just-in-time
+// fills of a static one. Conversion is compared with the type branch of the previous encoder.
+void benchmarkEncoding()
+{
+    for (const auto& format : convertFormats) measureDispatch(format);
+
+    const int fills = 3000;
+    for (const auto& format : convertFormats) {
+        WAVEFORMATEX wfx = makeFormat(WORD(format.bits), format.bits == 32);
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        builder->Initialize(FramesPerPeriod, &wfx);
+        double submitMs = 0;
+        size_t samples = 0;
+        for (int frame = 0; frame < BenchmarkFrames; frame++) {
+            drawScene(builder.get(), frame);
+            auto start = Clock::now();
+            builder->Submit();
+            submitMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            samples += builder->GetFrameStats().samples;
+        }
+
+        auto jit = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        jit->Initialize(FramesPerPeriod, &wfx);
+        jit->setJustInTime(true);
+        drawScene(jit.get(), 0);
+        jit->Submit();
+        std::vector<BYTE> buffer(jit->GetBufferLength());
+        auto start = Clock::now();
+        for (int i = 0; i < fills; i++) jit->FillSampleBuffer(UINT32(buffer.size()), buffer.data());
+        const double fillMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        LOG("%-6s submit %6.2f ns/sample  just in time fill %6.2f ns/sample", format.name, submitMs * 1e6 / samples,
+            fillMs * 1e6 / (double(fills) * FramesPerPeriod));
+    }
+}
+
+// Large circles and long lines so that primitives have many samples and cross buffer ends. Lines are on a transform
+// slot, so their samples are latched on output.
+void drawStrokes(AudioRender::IDrawDevice* device)
+{
+    device->Begin();
+    device->SetIntensity(1.0f);
+    for (int i = 0; i < 20; i++) {
+        device->SetPoint({0, 0});
+        device->DrawCircle(0.1f + 0.02f * i);
+    }
+    device->UpdateTransformSlot(0, AudioRender::Transform::Translate(0.01f, 0));
+    device->SetTransformSlot(0);
+    for (int i = 0; i < 40; i++) {
+        device->SetPoint({-0.45f, -0.45f + 0.0225f * i});
+        device->DrawLine({0.45f, 0.45f - 0.0225f * i});
+    }
+}
+
+// Output of the strokes scene, queued with repeated Submits or encoded just in time
+std::vector<BYTE> strokesOutput(const WAVEFORMATEX& format, bool justInTime, UINT32 spanFrames, size_t size)
+{
+    WAVEFORMATEX wfx = format;
+    auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+    builder->Initialize(FramesPerPeriod, &wfx);
+    builder->setJustInTime(justInTime);
+    for (int i = 0; i < (justInTime ? 1 : 20); i++) {
+        drawStrokes(builder.get());
+        builder->Submit();
+    }
+    return readOutput(builder.get(), wfx.nBlockAlign, spanFrames, size);
+}
+
+// Produced spans that are not a multiple of the period must give the same output as whole buffers. Cost of just in
+// time output is then measured with a headless consumer.
+void benchmarkSpans()
+{
+    const UINT32 spanFrames = 441;
+    for (const auto& format : convertFormats) {
+        const WAVEFORMATEX wfx = makeFormat(WORD(format.bits), format.bits == 32);
+        const size_t size = size_t(FramesPerPeriod) * wfx.nBlockAlign * 40;
+        for (bool justInTime : {false, true}) {
+            const bool same = strokesOutput(wfx, justInTime, 0, size) == strokesOutput(wfx, justInTime, spanFrames, size);
+            LOG("%-6s %-12s spans of %u frames match buffers: %s", format.name, justInTime ? "just in time" : "queued", spanFrames, same ? "yes" : "NO");
+        }
+    }
+
+    // Consumer runs alone on a static frame, so that the time is spent in encoding to its memory
+    for (UINT32 span : {0u, spanFrames}) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        WAVEFORMATEX wfx = makeFormat(16, false);
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->setJustInTime(true);
+        drawStrokes(builder.get());
+        builder->Submit();
+        double nsPerSample;
+        {
+            HeadlessConsumer consumer(builder.get(), span * wfx.nBlockAlign);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            nsPerSample = consumer.nsPerByte() * wfx.nBlockAlign;
+        }
+        LOG("just in time %-22s output %6.2f ns/sample", span ? "ProduceSamples 441" : "FillSampleBuffer 480", nsPerSample);
+    }
+}
+
+// Sharp cornered zigzag and star, a polygon with shallow corners and a line that fades out. Corners of the zigzag and
+// the star are returned.
+std::vector<AudioRender::Point> drawCorners(AudioRender::IDrawDevice* device, float intensity)
+{
+    const float Pi = 3.14159265f;
+    std::vector<AudioRender::Point> zigzag, star, polygon;
+    for (int i = 0; i < 9; i++) zigzag.push_back({-0.8f + 0.1f * i, i % 2 ? 0.7f : 0.3f});
+    for (int i = 0; i < 5; i++) star.push_back({0.4f + 0.35f * sinf(i * 4 * Pi / 5), 0.45f + 0.35f * cosf(i * 4 * Pi / 5)});
+    for (int i = 0; i < 48; i++) polygon.push_back({-0.4f + 0.3f * sinf(i * 2 * Pi / 48), -0.35f + 0.3f * cosf(i * 2 * Pi / 48)});
+
+    device->Begin();
+    device->SetIntensity(intensity);
+    device->DrawPolyline(zigzag.data(), zigzag.size(), false);
+    device->DrawPolyline(star.data(), star.size(), true);
+    device->DrawPolyline(polygon.data(), polygon.size(), true);
+    device->SetPoint({0.1f, -0.8f});
+    device->DrawLine({0.8f, -0.8f}, intensity * 0.25f);
+
+    std::vector<AudioRender::Point> corners(zigzag.begin() + 1, zigzag.end() - 1);
+    corners.insert(corners.end(), star.begin(), star.end());
+    return corners;
+}
+
+// Layers meet in the output when layer 0 ends at the origin, where the run of the next layer starts without a sync
+void drawLayerContinuation(AudioRender::IDrawDevice* device)
+{
+    device->DrawLine({0.0f, 0.0f});
+    device->SetLayer(1);
+    device->DrawLine({0.3f, 0.3f});
+    device->DrawLine({0.6f, 0.0f});
+    device->SetLayer(0);
+}
+
+// Distance of each corner to the output after the low-pass filtering of a sound card output, modeled as two one-pole
+// stages at 8 kHz
+void cornerErrors(const std::vector<BYTE>& output, const std::vector<AudioRender::Point>& corners, float& average, float& worst)
+{
+    const float a = 1.0f - expf(-2 * 3.14159265f * 8000.0f / 48000.0f);
+    const float* samples = reinterpret_cast<const float*>(output.data());
+    std::vector<float> nearest(corners.size(), 1e9f);
+    float x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    for (size_t i = 0; i < output.size() / 8; i++) {
+        x1 += a * (samples[i * 2] - x1);
+        y1 += a * (samples[i * 2 + 1] - y1);
+        x2 += a * (x1 - x2);
+        y2 += a * (y1 - y2);
+        for (size_t c = 0; c < corners.size(); c++) nearest[c] = std::min(nearest[c], hypotf(x2 - corners[c].x, y2 - corners[c].y));
+    }
+    average = 0;
+    worst = 0;
+    for (float d : nearest) {
+        average += d / corners.size();
+        worst = std::max(worst, d);
+    }
+}
+
+// Samples and corner rounding of the uniform sampling, of the uniform sampling with the intensity raised so that
+// corners get more samples, and of the motion profile. Sample counts of the motion profile counted for just in time
+// output must match the encoded ones, fails if they do not.
+bool benchmarkMotionProfile()
+{
+    WAVEFORMATEX wfx = makeFormat(32, true);
+    const size_t size = size_t(FramesPerPeriod) * wfx.nBlockAlign * 40;
+    const struct {
+        const char* name;
+        float intensity;
+        bool motion;
+    } configs[] = {{"uniform", 1.0f, false}, {"uniform x1.5", 1.5f, false}, {"motion profile", 1.0f, true}};
+    for (const auto& config : configs) {
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->setMotionProfile(config.motion);
+        std::vector<AudioRender::Point> corners;
+        for (int i = 0; i < 20; i++) {
+            corners = drawCorners(builder.get(), config.intensity);
+            builder->Submit();
+        }
+        const size_t samples = builder->GetFrameStats().samples;
+        float average, worst;
+        cornerErrors(readOutput(builder.get(), wfx.nBlockAlign, 0, size), corners, average, worst);
+        LOG("%-14s samples/frame %5zu  corner error avg %.4f  max %.4f", config.name, samples, average, worst);
+    }
+
+    bool matches = true;
+    for (bool layered : {false, true}) {
+        auto draw = [layered](AudioRender::IDrawDevice* device) {
+            drawCorners(device, 1.0f);
+            if (layered) drawLayerContinuation(device);
+        };
+        auto jit = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        jit->Initialize(FramesPerPeriod, &wfx);
+        jit->setJustInTime(true);
+        jit->setMotionProfile(true);
+        draw(jit.get());
+        jit->Submit();
+        const size_t counted = jit->GetFrameStats().samples;
+        // Refreshes follow each other, so the output repeats after the counted samples if they match the encoded ones
+        const std::vector<BYTE> output = readOutput(jit.get(), wfx.nBlockAlign, 0, size);
+        const size_t period = counted * wfx.nBlockAlign;
+        const bool repeats = period < size && std::equal(output.begin() + period, output.end(), output.begin());
+
+        auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+        builder->Initialize(FramesPerPeriod, &wfx);
+        builder->setMotionProfile(true);
+        draw(builder.get());
+        builder->Submit();
+        LOG("motion profile %-8s samples counted %zu  encoded %zu  just in time output repeats at counted: %s", layered ? "2 layers" : "1 layer",
+            counted, builder->GetFrameStats().samples, repeats ? "yes" : "NO");
+        matches = matches && repeats && counted == builder->GetFrameStats().samples;
+    }
+    if (!matches) LOGE("Motion profile sample counts do not match the output");
+    return matches;
+}
+
+// Output and list size of a frame drawn with and without vertex quantization
+struct QuantizedFrame {
+    std::vector<BYTE> output;
+    size_t listBytes;
+};
+
+QuantizedFrame drawQuantized(bool quantized, const std::function<void(AudioRender::IDrawDevice*)>& draw)
+{
+    WAVEFORMATEX wfx = makeFormat(32, true);
+    auto builder = std::make_shared<AudioRender::AudioGraphicsBuilder>();
+    builder->Initialize(FramesPerPeriod, &wfx);
+    builder->setVertexQuantization(quantized);
+    for (int i = 0; i < 20; i++) {
+        builder->Begin();
+        draw(builder.get());
+        builder->Submit();
+    }
+    return {readOutput(builder.get(), wfx.nBlockAlign, 0, size_t(FramesPerPeriod) * wfx.nBlockAlign * 10), builder->GetFrameStats().listBytes};
+}
+
+// SVG image in pixel units is scaled to the viewport by a transform, which quantized frames must draw the same as
+// unquantized ones. Untransformed drawing keeps the quantized storage. Fails if the SVG output does not match.
+bool benchmarkQuantization()
+{
+    // demo images are in the runtime directory
+    AudioRender::SVGImage image;
+    const char* name = nullptr;
+    for (const char* path : {"batman.svg", "runtime/batman.svg", "../runtime/batman.svg"}) {
+        if (image.loadImage(path)) {
+            name = path;
+            break;
+        }
+    }
+    if (!name) {
+        LOGE("batman.svg not found, run from the repository or the runtime directory");
+        return false;
+    }
+
+    auto drawSvg = [&](AudioRender::IDrawDevice* device) { image.drawImage(device, 1.8f); };
+    const QuantizedFrame svgFloat = drawQuantized(false, drawSvg);
+    const QuantizedFrame svgQuantized = drawQuantized(true, drawSvg);
+    const bool same = svgFloat.output == svgQuantized.output;
+    LOG("%-13s list %6zu bytes  quantized %6zu bytes  quantized output matches: %s", "svg", svgFloat.listBytes, svgQuantized.listBytes,
+        same ? "yes" : "NO");
+
+    auto drawRingsFrame = [](AudioRender::IDrawDevice* device) { drawRings(device, 0); };
+    const QuantizedFrame ringsFloat = drawQuantized(false, drawRingsFrame);
+    const QuantizedFrame ringsQuantized = drawQuantized(true, drawRingsFrame);
+    LOG("%-13s list %6zu bytes  quantized %6zu bytes", "untransformed", ringsFloat.listBytes, ringsQuantized.listBytes);
+
+    if (!same) LOGE("Quantized output of the transformed image differs");
+    return same;
+}
+}  // namespace
+
+bool runBenchmark(const std::string& name)
+{
+    if (name == "pipeline") {
+        benchmarkPipeline();
+    } else if (name == "optimizer") {
+        benchmarkOptimizer();
+    } else if (name == "clipping") {
+        benchmarkClipping();
+    } else if (name == "lod") {
+        benchmarkLevelOfDetail();
+    } else if (name == "simplify") {
+        benchmarkSimplification();
+    } else if (name == "curves") {
+        benchmarkCurves();
+    } else if (name == "instances") {
+        return benchmarkInstances();
+    } else if (name == "layers") {
+        benchmarkLayers();
+    } else if (name == "text") {
+        benchmarkText();
+    } else if (name == "progressive") {
+        benchmarkProgressive();
+    } else if (name == "alloc") {
+        benchmarkAllocations();
+    } else if (name == "threads") {
+        benchmarkThreads();
+    } else if (name == "wireframe") {
+        benchmarkWireframe();
+    } else if (name == "parametric") {
+        benchmarkParametric();
+    } else if (name == "latch") {
+        return benchmarkLatching();
+    } else if (name == "jit") {
+        return benchmarkJustInTime();
+    } else if (name == "ring") {
+        return benchmarkSampleRing();
+    } else if (name == "convert") {
+        benchmarkConversion();
+    } else if (name == "encode") {
+        benchmarkEncoding();
+    } else if (name == "span") {
+        benchmarkSpans();
+    } else if (name == "quantize") {
+        return benchmarkQuantization();
+    } else if (name == "motion") {
+        return benchmarkMotionProfile();
+    } else {
+        LOGE("Unknown benchmark \"%s\"", name.c_str());
+        return false;
+    }
+    return true;
+}
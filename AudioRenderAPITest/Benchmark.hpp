@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Runs a named benchmark without an audio device. Generated audio buffers are drained by
+// a headless consumer thread in place of the WASAPI render loop.
+// Returns false if the benchmark name is unknown or its checks fail.
+bool runBenchmark(const std::string& name);
@@ -12,6 +12,7 @@
 #include <SVGImage.hpp>
 
 #include "cxxopts.hpp"
+#include "Benchmark.hpp"
 
 #include <ToneSampleGenerator.hpp>
 #include <SimulatorView.hpp>
@@ -35,6 +36,9 @@ int main(int argc, char* argv[])
         ("A", "Audio render")            //
         ("I", "Integrator render")       //
         ("T", "Test audio tone render")  //
+        ("B", "Benchmark without audio device (pipeline, optimizer, clipping, lod, simplify, curves, instances, layers, text, progressive, alloc, threads, wireframe, parametric, latch, jit, ring, convert, encode, span, motion, quantize)", cxxopts::value<std::string>())  //
+        ("R", "Target refresh rate in Hz for audio render, detail is scaled to fit", cxxopts::value<float>())  //
+        ("J", "Encode on the audio thread just in time for audio render")  //
         ("D", "Demo mode (1 Basic, 2: Raster Image or 3: SVG Graphics)", cxxopts::value<int>()->default_value("1"));
 
     try {
@@ -90,6 +94,20 @@ int main(int argc, char* argv[])
             // flip x axis also for SVG images
             audioGenerator->setScale(-0.95f, -0.95f);
         }
+        if (demoMode != 1) {
+            // Images have many short strokes, draw them in the order that keeps beam travel short
+            audioGenerator->setPathOptimization(true);
+            // and merge the nearly collinear ones
+            audioGenerator->setSimplification(true);
+            // large images start playing while they are still encoded
+            audioGenerator->setProgressiveSubmit(true);
+        }
+        if (result.count("R")) {
+            audioGenerator->setTargetRefreshRate(result["R"].as<float>());
+        }
+        if (result.count("J")) {
+            audioGenerator->setJustInTime(true);
+        }
         audioDevice.SetGenerator(audioGenerator);
         if (audioDevice.Start()) {
             SetConsoleCtrlHandler(ctrlHandler, TRUE);
@@ -153,6 +171,8 @@ int main(int argc, char* argv[])
             LOG("Stopping");
             audioDevice.Stop();
         }
+    } else if (result.count("B")) {
+        if (!runBenchmark(result["B"].as<std::string>())) return 1;
     } else {
         printf("%s\n", options.help().c_str());
         return 1;
@@ -17,16 +17,8 @@ public:
 private:
     NSVGimage* m_image = NULL;
     IDrawDevice* m_device = NULL;
-    float m_hw = 0;
-    float m_hh = 0;
-    float m_xoff = 0;
-    float m_yoff = 0;
-
-    void vertex(float x, float y, bool first);
-    float m_xScale = 1.0f;
-    float m_yScale = 1.0f;
 
+    // Curves that stay within tol of a line are drawn as lines
     void drawPath(float* pts, int npts, char closed, float tol);
-    void cubicBez(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4, float tol, int level);
 };
 }  // namespace AudioRender
@@ -308,6 +308,8 @@ void SimulatorRenderView::Submit()
 
     std::lock_guard<std::mutex> lock(m_mutex);
 
+    const AudioRender::DisplayList& frame = PrepareFrame(m_recorder.List());
+
     ImDrawList* drawList = ImGui::GetWindowDrawList();
     // ImGui::GetIO();
     ImVec2 region = ImGui::GetContentRegionAvail();
@@ -317,7 +319,7 @@ void SimulatorRenderView::Submit()
 
     if (m_flicker) {
         // wpos.x = wpos.x + (-1 + GetTickCount() % 3);
-        float rel = m_operations.size() / 100.0f;
+        float rel = frame.Size() / 100.0f;
         rel = std::min(rel, 1.5f);
         wpos.x = wpos.x + (-rel + rel * (GetTickCount() % 3));
         wpos.y = wpos.y + (-rel + rel * (GetTickCount() % 3));
@@ -332,15 +334,50 @@ void SimulatorRenderView::Submit()
         return {p.x * width + wpos.x + region.x / 2 + m_drawXOffset, p.y * height + wpos.y + region.y / 2 + m_drawYOffset};
     };
 
-    for (size_t i = 0; i < m_operations.size(); i++) {
-        const GraphicsPrimitive& p = m_operations[i];
+    std::vector<ImVec2> ellipse;
+    AudioRender::ParametricSampler sampler;
+    AudioRender::DisplayList::Reader reader(frame);
+    GraphicsPrimitive p;
+    while (reader.Next(p)) {
         switch (p.type) {
             case GraphicsPrimitive::Type::DRAW_CIRCLE: {
-                drawList->AddCircle(p2p(p.p), width * p.r, color, std::lround(p.r * 50.f), log(10 * p.intensity));
+                const float Pi = 3.14159f;
+                const int segments = std::lround(p.r * 50.f);
+                if (p.IsArc()) {
+                    // clipped circle
+                    const int arcSegments = std::max(2, (int)std::lround(segments * (p.arcEnd - p.arcStart) / (2 * Pi)) + 1);
+                    ellipse.resize(arcSegments);
+                    for (int i = 0; i < arcSegments; i++) {
+                        const float t = p.arcStart + i * (p.arcEnd - p.arcStart) / (arcSegments - 1);
+                        ellipse[i] = p2p({p.p.x + sinf(t) * p.axisX.x + cosf(t) * p.axisY.x, p.p.y + sinf(t) * p.axisX.y + cosf(t) * p.axisY.y});
+                    }
+                    drawList->AddPolyline(ellipse.data(), arcSegments, color, false, log(10 * p.intensity));
+                } else if (p.axisX.x == p.axisY.y && p.axisX.y == -p.axisY.x) {
+                    drawList->AddCircle(p2p(p.p), width * p.r, color, segments, log(10 * p.intensity));
+                } else if (segments > 2) {
+                    // transformed to an ellipse
+                    ellipse.resize(segments);
+                    for (int i = 0; i < segments; i++) {
+                        const float s = sinf(i * 2 * Pi / segments);
+                        const float c = cosf(i * 2 * Pi / segments);
+                        ellipse[i] = p2p({p.p.x + s * p.axisX.x + c * p.axisY.x, p.p.y + s * p.axisX.y + c * p.axisY.y});
+                    }
+                    drawList->AddPolyline(ellipse.data(), segments, color, true, log(10 * p.intensity));
+                }
             } break;
             case GraphicsPrimitive::Type::DRAW_LINE: {
                 drawList->AddLine(p2p(p.p), p2p(p.toPoint), color, log(10 * p.intensity));
             } break;
+            case GraphicsPrimitive::Type::DRAW_CURVE: {
+                drawList->AddBezierCurve(p2p(p.p), p2p(p.control1), p2p(p.control2), p2p(p.toPoint), color, log(10 * p.intensity));
+            } break;
+            case GraphicsPrimitive::Type::DRAW_PARAMETRIC: {
+                // within a pixel of the curve
+                const size_t count = sampler.Flatten(p, 1.0f / width);
+                ellipse.resize(count);
+                for (size_t i = 0; i < count; i++) ellipse[i] = p2p(sampler.Points()[i]);
+                drawList->AddPolyline(ellipse.data(), int(count), color, false, log(10 * p.intensity));
+            } break;
             case GraphicsPrimitive::Type::DRAW_SYNC:
                 /*ignore*/
                 break;
@@ -351,8 +388,8 @@ void SimulatorRenderView::Submit()
     }
     if (m_idleBeam) {
         // Simulate empty data blocks that stop the beam on the middle
-        if (m_operations.size() < 100) {
-            float size = std::min(100.f / m_operations.size(), 20.f);
+        if (frame.Size() < 100) {
+            float size = std::min(100.f / frame.Size(), 20.f);
             drawList->AddCircle(p2p({0, 0}), 0.2f, color, 10, size);
         }
     }
@@ -154,3 +154,138 @@ __declspec(dllexport) void audioRender_DrawLine(audioRender_DrawDevice* device,
     if (device == nullptr || to == nullptr) return;
     getDrawDevice(device)->DrawLine({to->x, to->y}, intensity);
 }
+
+__declspec(dllexport) void audioRender_DrawQuadratic(
+    audioRender_DrawDevice* device, const struct audioRender_Point* control, const struct audioRender_Point* to)
+{
+    if (device == nullptr || control == nullptr || to == nullptr) return;
+    getDrawDevice(device)->DrawQuadratic({control->x, control->y}, {to->x, to->y});
+}
+
+__declspec(dllexport) void audioRender_DrawCubic(audioRender_DrawDevice* device, const struct audioRender_Point* control1,
+    const struct audioRender_Point* control2, const struct audioRender_Point* to)
+{
+    if (device == nullptr || control1 == nullptr || control2 == nullptr || to == nullptr) return;
+    getDrawDevice(device)->DrawCubic({control1->x, control1->y}, {control2->x, control2->y}, {to->x, to->y});
+}
+
+__declspec(dllexport) void audioRender_DrawArc(
+    audioRender_DrawDevice* device, const struct audioRender_Point* center, float radius, float startAngle, float endAngle)
+{
+    if (device == nullptr || center == nullptr) return;
+    getDrawDevice(device)->DrawArc({center->x, center->y}, radius, startAngle, endAngle);
+}
+
+// Points are passed to the device without copying
+static_assert(sizeof(audioRender_Point) == sizeof(AudioRender::Point), "Point layout mismatch");
+
+__declspec(dllexport) void audioRender_DrawPolyline(
+    audioRender_DrawDevice* device, const struct audioRender_Point* points, size_t count, audioRender_Bool closed)
+{
+    if (device == nullptr || points == nullptr) return;
+    getDrawDevice(device)->DrawPolyline(reinterpret_cast<const AudioRender::Point*>(points), count, closed != 0);
+}
+
+__declspec(dllexport) void audioRender_DrawPaths(
+    audioRender_DrawDevice* device, const struct audioRender_Point* points, const size_t* counts, size_t pathCount, audioRender_Bool closed)
+{
+    if (device == nullptr || points == nullptr || counts == nullptr) return;
+    getDrawDevice(device)->DrawPaths(reinterpret_cast<const AudioRender::Point*>(points), counts, pathCount, closed != 0);
+}
+
+__declspec(dllexport) void audioRender_DrawSinusoids(audioRender_DrawDevice* device, const struct audioRender_Sinusoid* x, size_t xCount,
+    const struct audioRender_Sinusoid* y, size_t yCount, float t0, float t1)
+{
+    if (device == nullptr || (x == nullptr && xCount) || (y == nullptr && yCount)) return;
+    auto curve = AudioRender::ParametricCurve::Sinusoids(reinterpret_cast<const AudioRender::ParametricCurve::Sinusoid*>(x), xCount,
+        reinterpret_cast<const AudioRender::ParametricCurve::Sinusoid*>(y), yCount);
+    getDrawDevice(device)->DrawParametric(std::move(curve), t0, t1);
+}
+
+__declspec(dllexport) void audioRender_DrawPolar(audioRender_DrawDevice* device, float r0, float growth, const struct audioRender_Sinusoid* terms,
+    size_t count, float t0, float t1)
+{
+    if (device == nullptr || (terms == nullptr && count)) return;
+    auto curve = AudioRender::ParametricCurve::Polar(r0, growth, reinterpret_cast<const AudioRender::ParametricCurve::Sinusoid*>(terms), count);
+    getDrawDevice(device)->DrawParametric(std::move(curve), t0, t1);
+}
+
+__declspec(dllexport) void audioRender_BeginShape(audioRender_DrawDevice* device)
+{
+    if (device == nullptr) return;
+    getDrawDevice(device)->BeginShape();
+}
+
+__declspec(dllexport) int32_t audioRender_EndShape(audioRender_DrawDevice* device)
+{
+    if (device == nullptr) return -1;
+    return getDrawDevice(device)->EndShape();
+}
+
+__declspec(dllexport) void audioRender_DrawInstance(
+    audioRender_DrawDevice* device, int32_t shape, const struct audioRender_Transform* t, float intensity)
+{
+    if (device == nullptr || t == nullptr) return;
+    getDrawDevice(device)->DrawInstance(shape, {t->a, t->b, t->c, t->d, t->tx, t->ty}, intensity);
+}
+
+__declspec(dllexport) void audioRender_DrawText(
+    audioRender_DrawDevice* device, const char* text, const struct audioRender_Point* position, float scale)
+{
+    if (device == nullptr || text == nullptr || position == nullptr) return;
+    getDrawDevice(device)->DrawText(text, {position->x, position->y}, scale);
+}
+
+__declspec(dllexport) void audioRender_SetTransform(audioRender_DrawDevice* device, const struct audioRender_Transform* t)
+{
+    if (device == nullptr || t == nullptr) return;
+    getDrawDevice(device)->SetTransform({t->a, t->b, t->c, t->d, t->tx, t->ty});
+}
+
+__declspec(dllexport) void audioRender_PushTransform(audioRender_DrawDevice* device, const struct audioRender_Transform* t)
+{
+    if (device == nullptr || t == nullptr) return;
+    getDrawDevice(device)->PushTransform({t->a, t->b, t->c, t->d, t->tx, t->ty});
+}
+
+__declspec(dllexport) void audioRender_PopTransform(audioRender_DrawDevice* device)
+{
+    if (device == nullptr) return;
+    getDrawDevice(device)->PopTransform();
+}
+
+__declspec(dllexport) void audioRender_SetLayer(audioRender_DrawDevice* device, int32_t layer)
+{
+    if (device == nullptr) return;
+    getDrawDevice(device)->SetLayer(layer);
+}
+
+__declspec(dllexport) void audioRender_SetTransformSlot(audioRender_DrawDevice* device, int32_t slot)
+{
+    if (device == nullptr) return;
+    getDrawDevice(device)->SetTransformSlot(slot);
+}
+
+__declspec(dllexport) void audioRender_UpdateTransformSlot(audioRender_DrawDevice* device, int32_t slot, const struct audioRender_Transform* t)
+{
+    if (device == nullptr || t == nullptr) return;
+    getDrawDevice(device)->UpdateTransformSlot(slot, {t->a, t->b, t->c, t->d, t->tx, t->ty});
+}
+
+__declspec(dllexport) void audioRender_SetClipping(audioRender_DrawDevice* device, audioRender_Bool enabled)
+{
+    if (device == nullptr) return;
+    getDrawDevice(device)->SetClipping(enabled != 0);
+}
+
+__declspec(dllexport) void audioRender_RecordList(audioRender_DrawDevice* device, const char* name)
+{
+    if (device == nullptr || name == nullptr) return;
+    getDrawDevice(device)->RecordList(name);
+}
+
+__declspec(dllexport) audioRender_Bool audioRender_ReplayList(audioRender_DrawDevice* device, const char* name)
+{
+    if (device == nullptr || name == nullptr) return false;
+    return getDrawDevice(device)->ReplayList(name);
+}
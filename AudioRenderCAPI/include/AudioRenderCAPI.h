@@ -1,6 +1,7 @@
 #ifndef AUDIO_RENDER_C_API_H
 #define AUDIO_RENDER_C_API_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef AUDIO_RENDER_EXPORTS
@@ -28,6 +29,25 @@ struct audioRender_Point {
     float y;
 };
 
+// amplitude * sin(frequency * t + phase)
+struct audioRender_Sinusoid {
+    float amplitude;
+    float frequency;
+    float phase;
+};
+
+// 2D affine transform
+// x' = a * x + c * y + tx
+// y' = b * x + d * y + ty
+struct audioRender_Transform {
+    float a;
+    float b;
+    float c;
+    float d;
+    float tx;
+    float ty;
+};
+
 // Create draw device which uses audio as output
 AUDIO_RENDER_API audioRender_DrawDevice* audioRender_DeviceInitAudioRender(float scaleX, float scaleY);
 
@@ -66,6 +86,80 @@ AUDIO_RENDER_API void audioRender_DrawCircle(audioRender_DrawDevice* device, flo
 // Line intensity will lerp linearnly towards intensity, if >.
 AUDIO_RENDER_API void audioRender_DrawLine(audioRender_DrawDevice* device, const struct audioRender_Point* to, float intensity = -1);
 
+// draw quadratic Bezier curve from current point to target point. Target point becomes new current point.
+AUDIO_RENDER_API void audioRender_DrawQuadratic(
+    audioRender_DrawDevice* device, const struct audioRender_Point* control, const struct audioRender_Point* to);
+
+// draw cubic Bezier curve from current point to target point. Target point becomes new current point.
+AUDIO_RENDER_API void audioRender_DrawCubic(audioRender_DrawDevice* device, const struct audioRender_Point* control1,
+    const struct audioRender_Point* control2, const struct audioRender_Point* to);
+
+// draw arc of a circle around center. Angles are in radians, angle 0 is on the positive x axis and angles grow
+// towards the positive y axis. Current point is not changed.
+AUDIO_RENDER_API void audioRender_DrawArc(
+    audioRender_DrawDevice* device, const struct audioRender_Point* center, float radius, float startAngle, float endAngle);
+
+// set first point as current point and draw lines through the rest. Closed polyline is drawn back to the first point.
+AUDIO_RENDER_API void audioRender_DrawPolyline(
+    audioRender_DrawDevice* device, const struct audioRender_Point* points, size_t count, audioRender_Bool closed);
+
+// draw several polylines. Points of the paths are stored back to back and counts has the number of points in each path.
+AUDIO_RENDER_API void audioRender_DrawPaths(
+    audioRender_DrawDevice* device, const struct audioRender_Point* points, const size_t* counts, size_t pathCount, audioRender_Bool closed);
+
+// draw curve x(t), y(t) from t0 to t1, where x and y are sums of their sinusoid terms. Covers Lissajous figures.
+// The curve is sampled when the frame is encoded. Current point is not changed.
+AUDIO_RENDER_API void audioRender_DrawSinusoids(audioRender_DrawDevice* device, const struct audioRender_Sinusoid* x, size_t xCount,
+    const struct audioRender_Sinusoid* y, size_t yCount, float t0, float t1);
+
+// draw polar curve at angle t from t0 to t1 with radius r0 + growth * t plus the sum of the sinusoid terms. Covers
+// spirals and roses. The curve is sampled when the frame is encoded. Current point is not changed.
+AUDIO_RENDER_API void audioRender_DrawPolar(audioRender_DrawDevice* device, float r0, float growth, const struct audioRender_Sinusoid* terms,
+    size_t count, float t0, float t1);
+
+// start recording a reusable shape. Primitives drawn until audioRender_EndShape go to the shape instead of the frame.
+AUDIO_RENDER_API void audioRender_BeginShape(audioRender_DrawDevice* device);
+
+// end shape recording. Returns the shape identifier for audioRender_DrawInstance or -1 if no shape was started.
+AUDIO_RENDER_API int32_t audioRender_EndShape(audioRender_DrawDevice* device);
+
+// draw a recorded shape with transform t applied on top of the current transform. Intensity >= 0 overrides the
+// intensities of the shape. Current point is not changed.
+AUDIO_RENDER_API void audioRender_DrawInstance(
+    audioRender_DrawDevice* device, int32_t shape, const struct audioRender_Transform* t, float intensity = -1);
+
+// draw text with the built-in stroke font. Position is the left end of the baseline and scale is the height of
+// capital letters. Lines are separated by '\n'.
+AUDIO_RENDER_API void audioRender_DrawText(audioRender_DrawDevice* device, const char* text, const struct audioRender_Point* position, float scale);
+
+// set transform of points and circles drawn after this call. Transform is reset to identity on Begin.
+AUDIO_RENDER_API void audioRender_SetTransform(audioRender_DrawDevice* device, const struct audioRender_Transform* t);
+
+// save current transform and combine t with it. t is applied first.
+AUDIO_RENDER_API void audioRender_PushTransform(audioRender_DrawDevice* device, const struct audioRender_Transform* t);
+
+// restore transform saved by the matching audioRender_PushTransform
+AUDIO_RENDER_API void audioRender_PopTransform(audioRender_DrawDevice* device);
+
+// set layer of primitives drawn after this call. Layer is reset to 0 on audioRender_Begin.
+AUDIO_RENDER_API void audioRender_SetLayer(audioRender_DrawDevice* device, int32_t layer);
+
+// tag primitives drawn after this call with a transform slot, -1 for none. Slot is reset to -1 on audioRender_Begin.
+AUDIO_RENDER_API void audioRender_SetTransformSlot(audioRender_DrawDevice* device, int32_t slot);
+
+// set transform of a slot, applied on top of the transforms of the tagged primitives. Can be called from any thread,
+// also after the frame has been submitted. Audio output applies it to the samples as they are played.
+AUDIO_RENDER_API void audioRender_UpdateTransformSlot(audioRender_DrawDevice* device, int32_t slot, const struct audioRender_Transform* t);
+
+// clip lines and circles to the viewport instead of drawing them outside of it. Disabled by default.
+AUDIO_RENDER_API void audioRender_SetClipping(audioRender_DrawDevice* device, audioRender_Bool enabled);
+
+// store primitives drawn since Begin as a named display list
+AUDIO_RENDER_API void audioRender_RecordList(audioRender_DrawDevice* device, const char* name);
+
+// replace current drawing with a recorded display list. Returns false if there is no list with the name.
+AUDIO_RENDER_API audioRender_Bool audioRender_ReplayList(audioRender_DrawDevice* device, const char* name);
+
 #if defined __cplusplus
 }
 #endif
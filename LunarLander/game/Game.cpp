@@ -14,6 +14,8 @@
 #include <glm/gtx/rotate_vector.hpp>
 #undef GLM_ENABLE_EXPERIMENTAL
 
+#include <StrokeFont.hpp>
+
 #include "Game.hpp"
 #include "Terrain.hpp"
 
@@ -88,116 +90,13 @@ struct Key : Button {
     bool pressed() override { return keyPressed; }
 };
 
-// Utility to write text on the view
-struct TextUtil {
-    using Character = std::vector<std::vector<AudioRender::Point>>;
-
-    const Character l_A = {{{0, 0}, {0, -7.5}, {1, -10}, {2.5, -10}, {3.5, -7.5}, {3.5, 0}}, {{0, -5}, {3.5, -5}}};
-    const Character l_E = {{{3.5f, 0}, {0, 0}, {0, -10}, {3.5f, -10}}, {{0, -5.f}, {3, -5.f}}};
-    const Character l_F = {{{0, 0}, {0, -10}, {4, -10}}, {{0, -5.f}, {3, -5.f}}};
-    const Character l_I = {{{0, 0}, {0, -10}}};
-    const Character l_K = {{{0, 0}, {0, -10}}, {{4, -10}, {0, -5}, {4, 0}}};
-    const Character l_L = {{{0, -10}, {0, 0}, {3.5f, 0}}};
-    const Character l_O = {{{3, 0}, {6, -5}, {3, -10}, {0, -5}, {3, 0}}};
-    const Character l_P = {{{0, 0}, {0, -10}, {1, -10}, {3.5, -9}, {3.5, -6}, {1, -5}, {0, -5}}};
-    const Character l_R = {{{0, 0}, {0, -10}, {5, -7}, {0, -3}, {5, 0}}};
-    const Character l_S = {{{3.5, -10}, {0, -10}, {0, -5}, {3.5, -5}, {3.5, 0}, {0, 0}}};
-    const Character l_U = {{{0, -10}, {0, 0}, {3.5f, 0}, {3.5f, -10}}};
-    const Character l_W = {{{0, -10}, {6.f / 3, 0}, {6.f / 2, -6}, {6.f - 6.f / 3, 0}, {6, -10}}};
-    const Character l_N = {{{0, 0}, {0, -10}, {4, 0}, {4, -10}}};
-    const Character l_D = {{{0, 0}, {0, -10}, {3.5, -8}, {3.5, -2}, {0, 0}}};
-    const Character l__ = {{{0, 0}, {4, 0}}};
-
-    const Character d0 = {{{0, 0}, {0, -10}, {4, -10}, {4, 0}, {0, 0}, {4, -10}}};
-    const Character d1 = {{{2, 0}, {2, -10}, {1, -9}}};
-    const Character d2 = {{{0, -10}, {4, -10}, {4, -5}, {0, -5}, {0, 0}, {4, 0}}};
-    const Character d3 = {{{0, -10}, {4, -10}, {4, 0}, {0, 0}}, {{1, -5}, {4, -5}}};
-    const Character d4 = {{{4, 0}, {4, -10}, {0, -4}, {5, -4}}};
-    const Character d5 = {{{0, 0}, {4, 0}, {4, -5}, {0.5, -5}, {0.5, -10}, {4, -10}}};
-    const Character d6 = {{{0, -5}, {4, -5}, {4, 0}, {0, 0}, {0, -10}, {4, -10}}};
-    const Character d7 = {{{3, 0}, {4, -10}, {0, -10}}};
-    const Character d8 = {{{0, 0}, {0, -10}, {4, -10}, {4, 0}, {0, 0}}, {{0, -5}, {4, -5}}};
-    const Character d9 = {{{3, 0}, {4, -10}, {0, -10}, {0, -6}, {4, -6}}};
-
-    const Character* digits[10] = {&d0, &d1, &d2, &d3, &d4, &d5, &d6, &d7, &d8, &d9};
-
-    const float letterScale = 1.f / 10 * 0.2f;
-    AudioRender::IDrawDevice* device;
-    const Character* letters[0xFF + 1];
-
-    TextUtil(AudioRender::IDrawDevice* drawDevice)
-        : device(drawDevice)
-    {
-        for (int i = 0; i <= 0xFF; i++) {
-            letters[i] = &l__;
-        }
-        letters['A'] = &l_A;
-        letters['E'] = &l_E;
-        letters['F'] = &l_F;
-        letters['I'] = &l_I;
-        letters['K'] = &l_K;
-        letters['L'] = &l_L;
-        letters['O'] = &l_O;
-        letters['P'] = &l_P;
-        letters['R'] = &l_R;
-        letters['S'] = &l_S;
-        letters['U'] = &l_U;
-        letters['W'] = &l_W;
-        letters['N'] = &l_N;
-        letters['D'] = &l_D;
-        letters['0'] = &d0;
-        letters['1'] = &d1;
-        letters['2'] = &d2;
-        letters['3'] = &d3;
-        letters['4'] = &d4;
-        letters['5'] = &d5;
-        letters['6'] = &d6;
-        letters['7'] = &d7;
-        letters['8'] = &d8;
-        letters['9'] = &d9;
-    }
-
-    void drawCharacter(char c, float xpos, float ypos, float scale = 1.0f) { drawCharacter(letters[c], xpos, ypos, scale); };
-
-    void drawDigit(int d, float xpos, float ypos, float scale = 1.0f) { drawCharacter(digits[d % 10], xpos, ypos, scale); };
-
-    void writeText(const char* text, float xpos, float ypos, float scale = 1.0f)
-    {
-        static float widthCache[0xFF + 1] = {0};
-        const float spacing = 2.f;
-
-        while (char c = *text++) {
-            const Character* cr = letters[c];
-
-            float width = widthCache[c];
-            if (width == 0.0f) {
-                float minx = std::numeric_limits<float>::max();
-                float maxx = std::numeric_limits<float>::min();
-                for (auto& seg : *cr) {
-                    for (auto& p : seg) {
-                        minx = std::min(minx, p.x);
-                        maxx = std::max(maxx, p.x);
-                    }
-                }
-                width = widthCache[c] = std::max(std::abs(maxx - minx), 1.5f);
-            }
-            drawCharacter(cr, xpos, ypos, scale);
-            xpos += width + spacing;
-        }
-    };
-
-private:
-    void drawCharacter(const Character* lf, float xpos, float ypos, float scale)
-    {
-        const AudioRender::Point offset{xpos, ypos};
-        for (const auto& seg : *lf) {
-            device->SetPoint((seg[0] + offset) * letterScale * scale);
-            for (size_t i = 1; i < seg.size(); i++) {
-                device->DrawLine((seg[i] + offset) * letterScale * scale);
-            }
-        }
-    };
-};
+// Writes text centered on the view horizontally, y is the baseline
+static void writeText(AudioRender::IDrawDevice* device, const char* text, float y, float scale = 0.2f)
+{
+    const float width = AudioRender::StrokeFont::TextWidth(text) * scale / AudioRender::StrokeFont::CapHeight;
+    device->SetIntensity(0.25f);
+    device->DrawText(text, {-width / 2, y}, scale);
+}
 
 // Vector implementation
 using Vector2D = glm::ivec2;
@@ -352,12 +251,13 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 {
     srand(time(NULL));
 
+    // terrain and lander leave the screen when zoomed in
+    device->SetClipping(true);
+
     ViewPort viewport;
     viewport.reset();
 
     Controller controller;
-    struct TextUtil textUtil(device);
-
     Map map;
 
     auto generateLevel = [&](int level) { map = generateTerrain(level, viewport.width); };
@@ -371,6 +271,11 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 
     Lander lander;
 
+    // Terrain and lander polylines of the current frame, storage is reused between frames
+    std::vector<AudioRender::Point> terrainPoints;
+    std::vector<AudioRender::Point> points;
+    std::vector<AudioRender::Point> outline;
+
     auto updateLanderPosition = [&](Vector2Df& pos, float minheight) {
         int xs = (int)std::floorf(pos.x - lander.width - 20);
         const int xe = (int)std::ceilf(pos.x + lander.width + 20);
@@ -436,7 +341,7 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 
         if (paused) {
             if (paused == 1) {
-                textUtil.writeText("PAUSED", -15, -10.0f, .5f);
+                writeText(device, "PAUSED", -0.1f, 0.1f);
                 paused = 2;
             }
             // just show last render
@@ -488,21 +393,16 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 
         if (gameState == ST_WAIT) {
             // Level
-            float offset = 0;
-            int digit = level;
-            do {
-                textUtil.drawDigit(digit % 10, offset, -5);
-                offset -= 5.5f;
-                digit /= 10;
-            } while (digit > 0);
-            textUtil.drawCharacter('L', offset, -5);
+            char buffer[16];
+            snprintf(buffer, sizeof(buffer), "L%d", level);
+            writeText(device, buffer, -0.1f);
 
             if (controller.throttle.pressed() || controller.left.pressed() || controller.right.pressed()) {
                 gameState = ST_PLAY;
             }
         } else if (gameState == ST_WIN) {
             // W I N
-            textUtil.writeText("WIN", -8, -5.2f);
+            writeText(device, "WIN", -0.104f);
 
             if (coolDownTimer.update(elapsed / 1000.f)) {
                 if (controller.throttle.pressed()) {
@@ -512,7 +412,7 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
             }
         } else if (gameState == ST_FAIL) {
             // F A I L
-            textUtil.writeText("FAIL", -8, -5.2f);
+            writeText(device, "FAIL", -0.104f);
 
             if (coolDownTimer.update(elapsed / 1000.f)) {
                 if (controller.throttle.pressed()) {
@@ -566,28 +466,16 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 
             float terrainyOffset = viewport.pos.y - viewport.terrainPos.y;
 
-            // Draw terrain
-            int xs = terrainxs;
-
-            float y0 = (map.terrain[xs] - terrainyOffset) * windowScale;
-            xs += step;
-            bool newSeg = true;
-            for (; xs < terrainxe; xs += step) {
-                float y1 = (map.terrain[xs] - terrainyOffset) * windowScale;
-                if (std::fabsf(y0) > 0.55f && std::fabs(y1) > 0.55f) {  // not visible segment
-                    y0 = y1;
-                    newSeg = true;
-                    continue;
-                }
-                if (newSeg) {
-                    device->SetPoint({(xs - step - viewport.pos.x) * windowScale, y0});
-                    newSeg = false;
-                }
-                const float x = (xs - viewport.pos.x) * windowScale;
-                device->DrawLine({x, y1});
-                y0 = y1;
-            }
+            // Terrain is drawn in map coordinates, the device clips it to the viewport. It is on the background
+            // layer, which can be refreshed less often than the lander and the texts.
+            device->SetLayer(1);
+            device->PushTransform(AudioRender::Transform::Scale(windowScale) * AudioRender::Transform::Translate(-viewport.pos.x, -terrainyOffset));
 
+            terrainPoints.clear();
+            for (int xs = terrainxs; xs < terrainxe; xs += step) {
+                terrainPoints.push_back({(float)xs, (float)map.terrain[xs]});
+            }
+            device->DrawPolyline(terrainPoints.data(), terrainPoints.size());
 
             // Mark landing places
             device->SetIntensity(0.5f);
@@ -595,12 +483,12 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
                 if (p.first > terrainxe) continue;
                 if (p.second < terrainxs) continue;
 
-                const float y = (map.terrain[p.first] - terrainyOffset + 1) * windowScale;
-                if (std::fabsf(y) > 0.55f) continue;  // not visible
-
-                device->SetPoint({(p.first - viewport.pos.x) * windowScale, y});
-                device->DrawLine({(p.second - viewport.pos.x) * windowScale, y});
+                const float y = map.terrain[p.first] + 1.f;
+                device->SetPoint({(float)p.first, y});
+                device->DrawLine({(float)p.second, y});
             }
+            device->PopTransform();
+            device->SetLayer(0);
         }
 
         // Lander
@@ -621,42 +509,43 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 
         device->SetIntensity(1.0f);
 
-        // lander position
-        auto rotatedPoint = [&](float x, float y) -> AudioRender::Point {
-            auto v = vrotate(Vector2Df(x, y), lander.angle);
-            // v += offset;
-            return {v.x, v.y};
-        };
-
+        // lander outline, drawn unrotated on a transform slot
         // TODO move rotation point on the middle of mass?
-        std::vector<AudioRender::Point> points;
+        outline.clear();
         if (gameState == ST_FAIL) {
             // Crashed lander
-            points.push_back(rotatedPoint(0.5f, -lander.height / 2 - 0.2f));
-            points.push_back(rotatedPoint(-0.5f - lander.width / 2, lander.height / 5 + 0.5f));  // left
-            points.push_back(rotatedPoint(0, 0));                                                // center
-            points.push_back(rotatedPoint(lander.width / 2 + 0.1f, 2.f - lander.height / 5));    // right
-            points.push_back(rotatedPoint(0.4f, -1.f - lander.height / 2));
+            outline.push_back({0.5f, -lander.height / 2 - 0.2f});
+            outline.push_back({-0.5f - lander.width / 2, lander.height / 5 + 0.5f});  // left
+            outline.push_back({0, 0});                                                // center
+            outline.push_back({lander.width / 2 + 0.1f, 2.f - lander.height / 5});    // right
+            outline.push_back({0.4f, -1.f - lander.height / 2});
         } else {
             // Pristine lander
-            points.push_back(rotatedPoint(0, lander.height / 2));
-            points.push_back(rotatedPoint(-lander.width / 2, lander.height / 2));
-            points.push_back(rotatedPoint(-lander.width / 2, -(lander.height / 2 - 2.5f)));
-            points.push_back(rotatedPoint(-lander.width / 2 + 1.5f, -lander.height / 2));
-            points.push_back(rotatedPoint(lander.width / 2 - 1.5f, -lander.height / 2));
-            points.push_back(rotatedPoint(lander.width / 2, -(lander.height / 2 - 2.5f)));
-            points.push_back(rotatedPoint(lander.width / 2, lander.height / 2));
-            points.push_back(rotatedPoint(0, lander.height / 2));
+            outline.push_back({0, lander.height / 2});
+            outline.push_back({-lander.width / 2, lander.height / 2});
+            outline.push_back({-lander.width / 2, -(lander.height / 2 - 2.5f)});
+            outline.push_back({-lander.width / 2 + 1.5f, -lander.height / 2});
+            outline.push_back({lander.width / 2 - 1.5f, -lander.height / 2});
+            outline.push_back({lander.width / 2, -(lander.height / 2 - 2.5f)});
+            outline.push_back({lander.width / 2, lander.height / 2});
+            outline.push_back({0, lander.height / 2});
 
             /*
-            points.push_back(rotatedPoint(0, -lander.height / 2));
-            points.push_back(rotatedPoint(-lander.width / 2, lander.height / 5));  // left
-            points.push_back(rotatedPoint(0, 0));                                  // center
-            points.push_back(rotatedPoint(lander.width / 2, lander.height / 5));   // right
-            points.push_back(rotatedPoint(0, -lander.height / 2));
+            outline.push_back({0, -lander.height / 2});
+            outline.push_back({-lander.width / 2, lander.height / 5});  // left
+            outline.push_back({0, 0});                                  // center
+            outline.push_back({lander.width / 2, lander.height / 5});   // right
+            outline.push_back({0, -lander.height / 2});
             */
         }
 
+        // collision test uses the rotated outline
+        points.clear();
+        for (const auto& p : outline) {
+            auto v = vrotate(Vector2Df(p.x, p.y), lander.angle);
+            points.push_back({v.x, v.y});
+        }
+
         if (gameState == ST_PLAY || gameState == ST_WAIT) {
             // Check for collisions
 
@@ -727,14 +616,14 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
 
         // draw lander
         {
+            // Lander is placed by a transform slot, so that its position and rotation reach the beam with the buffers
+            // already queued instead of waiting behind them
             const Vector2Df centerOffset = lander.pos - viewport.pos;
-            for (auto& p : points) {
-                p.x += centerOffset.x;
-                p.y += centerOffset.y;
-            }
+            device->UpdateTransformSlot(0, AudioRender::Transform::Scale(windowScale) * AudioRender::Transform::Translate(centerOffset.x, centerOffset.y) *
+                                               AudioRender::Transform::Rotate(lander.angle));
+            device->SetTransformSlot(0);
 
-            device->SetPoint((points[0]) * windowScale);
-            for (size_t i = 1; i < points.size(); i++) device->DrawLine(points[i] * windowScale);
+            device->DrawPolyline(outline.data(), outline.size());
 
             if (engineon) {
                 // draw engine exhaust
@@ -744,20 +633,9 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
                 float h = lander.height;
                 h = h + h * ((float)rand() / RAND_MAX - 0.5f);
 
-                std::array<AudioRender::Point, 4> exhaust = {            //
-                    rotatedPoint(0, h),                                  //
-                    rotatedPoint(-lander.width / 4, lander.height / 2),  //
-                    rotatedPoint(0, h),                                  //
-                    rotatedPoint(lander.width / 4, lander.height / 2)};
-                for (auto& p : exhaust) {
-                    p.x += centerOffset.x;
-                    p.y += centerOffset.y;
-                }
-
-                device->SetPoint(exhaust[0] * windowScale);
-                device->DrawLine(exhaust[1] * windowScale);
-                device->SetPoint(exhaust[2] * windowScale);
-                device->DrawLine(exhaust[3] * windowScale);
+                const AudioRender::Point exhaust[] = {{0, h}, {-lander.width / 4, lander.height / 2}, {0, h}, {lander.width / 4, lander.height / 2}};
+                const size_t exhaustPaths[] = {2, 2};
+                device->DrawPaths(exhaust, exhaustPaths, 2);
             }
 
             if ((controller.left.status() || controller.right.status()) && viewport.zoom >= 2) {
@@ -767,20 +645,11 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
                 float s = (float)rand() / RAND_MAX;
 
                 auto drawSteer = [&](int pos) {
-                    std::array<AudioRender::Point, 3> control = {                                 //
-                        rotatedPoint(pos * (-lander.width / 2 + .5f), -lander.height / 2 + .7f),  //
-                        rotatedPoint(pos * (-lander.width + s), -lander.height / 2 + -.2f),       //
-                        rotatedPoint(pos * (-lander.width / 2 + .6f), -lander.height / 2 + .3)};
-
-                    for (auto& p : control) {
-                        p.x += centerOffset.x;
-                        p.y += centerOffset.y;
-                    }
-
-                    device->SetPoint(control[0] * windowScale);
-                    for (size_t i = 1; i < control.size(); i++) {
-                        device->DrawLine(control[i] * windowScale);
-                    }
+                    const AudioRender::Point control[] = {                           //
+                        {pos * (-lander.width / 2 + .5f), -lander.height / 2 + .7f},  //
+                        {pos * (-lander.width + s), -lander.height / 2 + -.2f},       //
+                        {pos * (-lander.width / 2 + .6f), -lander.height / 2 + .3f}};
+                    device->DrawPolyline(control, 3);
                 };
 
                 if (controller.right.status()) {
@@ -790,6 +659,7 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
                     drawSteer(-1);
                 }
             }
+            device->SetTransformSlot(-1);
         }
 
 
@@ -799,7 +669,7 @@ void Game::mainLoop(std::atomic_bool& running, AudioRender::IDrawDevice* device)
             if (p >= 0) {                                
                 char buffer[16];
                 snprintf(buffer, sizeof(buffer), "%02d", (int)std::roundf(p * 100));                
-                textUtil.writeText(buffer, -8, -35.0f, .5f);
+                writeText(device, buffer, -0.35f, 0.1f);
             }
         }
 
@@ -101,6 +101,8 @@ int main(int argc, char* argv[])
         audioDevice.Initialize();
         auto audioGenerator = std::make_shared<AudioRender::AudioGraphicsBuilder>();
         audioGenerator->setScale(xScale, yScale);
+        // terrain on every second refresh
+        audioGenerator->setLayerRefreshDivisor(1, 2);
         audioDevice.SetGenerator(audioGenerator);
         audioDevice.Start();
 
@@ -126,6 +128,7 @@ int main(int argc, char* argv[])
         }
 
         // intDevice->setScale(X_SCALE, Y_SCALE);
+        intDevice->setLayerRefreshDivisor(1, 2);
 
         SetConsoleCtrlHandler(ctrlHandler, TRUE);
 